@@ -0,0 +1,344 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "basic_chip_spi.hpp"
+#include "driver_facade.hpp"
+#include "eeprom_model.hpp"
+#include "gpio_trace.hpp"
+#include "nor_flash.hpp"
+#include "nor_flash_model.hpp"
+#include "spi_bus.hpp"
+#include "striped_memory_device.hpp"
+
+/**
+ * @brief Port-capable GPIO stand-in backed by a single register.
+ *
+ * MISO is wired back to MOSI. Declared final so that the
+ * statically specialized SPI master can inline every access.
+ */
+class fast_gpio_driver final : public i_chip_gpio_driver {
+public:
+  void setHigh(int pin) override { port_ = port_ | (uint32_t{1} << pin); }
+  void setLow(int pin) override { port_ = port_ & ~(uint32_t{1} << pin); }
+  bool read(int) override { return (port_ >> MOSI) & 0x1; }
+
+  bool hasPortAccess() const override { return true; }
+  void setMask(uint32_t mask) override { port_ = port_ | mask; }
+  void clearMask(uint32_t mask) override { port_ = port_ & ~mask; }
+  void writePort(uint32_t mask, uint32_t values) override {
+    port_ = (port_ & ~mask) | (values & mask);
+  }
+
+  void submit(const gpio_edge *edges, std::size_t count,
+              uint32_t /*sampleMask*/, uint8_t *rxOut) override {
+    std::size_t bit = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      port_ = (port_ & ~edges[i].mask) | (edges[i].values & edges[i].mask);
+      if (!edges[i].sample || !rxOut)
+        continue;
+      uint8_t &byte = rxOut[bit++ / 8];
+      byte = static_cast<uint8_t>((byte << 1) | ((port_ >> MOSI) & 0x1));
+    }
+  }
+
+  static constexpr int CS = 0;
+  static constexpr int SCK = 1;
+  static constexpr int MOSI = 2;
+  static constexpr int MISO = 3;
+
+private:
+  volatile uint32_t port_ = 0; ///< Emulated output/input register
+};
+
+/**
+ * @brief Report the per-byte cost of a run.
+ * @param state Benchmark state
+ */
+static void reportPerByte(benchmark::State &state) {
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  state.counters["per_byte"] = benchmark::Counter(
+      static_cast<double>(state.range(0)),
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+}
+
+/**
+ * @brief Type-erased chip_spi_api, virtual GPIO calls for every edge.
+ */
+static void BM_ChipSpiApiTransfer(benchmark::State &state) {
+  fast_gpio_driver gpio;
+  chip_spi_api spi(gpio, fast_gpio_driver::CS, fast_gpio_driver::SCK,
+                   fast_gpio_driver::MOSI, fast_gpio_driver::MISO,
+                   spi_timing(spi_timing::mode::none));
+  i_chip_spi_api &api = spi;
+
+  std::vector<uint8_t> tx(state.range(0), 0xA5);
+  std::vector<uint8_t> rx(state.range(0));
+
+  for (auto _ : state) {
+    api.transfer(tx.data(), rx.data(), tx.size());
+    benchmark::DoNotOptimize(rx.data());
+  }
+  reportPerByte(state);
+}
+BENCHMARK(BM_ChipSpiApiTransfer)->Arg(1)->Arg(16)->Arg(512);
+
+/**
+ * @brief BM_ChipSpiApiTransfer behind tracing_gpio_driver.
+ *
+ * The ring is drained outside the timed region, so the figure is
+ * what tracing costs the traced bus.
+ */
+static void BM_TracedChipSpiApiTransfer(benchmark::State &state) {
+  fast_gpio_driver inner;
+  gpio_trace_ring ring(1 << 16);
+  tracing_gpio_driver gpio(inner, ring);
+  chip_spi_api spi(gpio, fast_gpio_driver::CS, fast_gpio_driver::SCK,
+                   fast_gpio_driver::MOSI, fast_gpio_driver::MISO,
+                   spi_timing(spi_timing::mode::none));
+
+  std::vector<uint8_t> tx(state.range(0), 0xA5);
+  std::vector<uint8_t> rx(state.range(0));
+  std::vector<gpio_trace_event> events(ring.capacity());
+
+  for (auto _ : state) {
+    spi.transfer(tx.data(), rx.data(), tx.size());
+    benchmark::DoNotOptimize(rx.data());
+
+    state.PauseTiming();
+    while (ring.pop(events.data(), events.size()) != 0) {
+    }
+    state.ResumeTiming();
+  }
+  if (ring.dropped() != 0)
+    state.SkipWithError("trace ring overflowed");
+  reportPerByte(state);
+}
+BENCHMARK(BM_TracedChipSpiApiTransfer)->Arg(16)->Arg(512);
+
+/**
+ * @brief Whole transactions, arg 1 selects the path.
+ *
+ * 0 makes the select(), transfer() and deselect() calls, 1 hands
+ * a precompiled waveform to the driver in one submit().
+ */
+static void BM_ChipSpiApiTransaction(benchmark::State &state) {
+  fast_gpio_driver gpio;
+  chip_spi_api spi(gpio, fast_gpio_driver::CS, fast_gpio_driver::SCK,
+                   fast_gpio_driver::MOSI, fast_gpio_driver::MISO,
+                   spi_timing(spi_timing::mode::none));
+  i_chip_spi_api &api = spi;
+  const bool waveform = state.range(1) != 0;
+
+  std::vector<uint8_t> tx(state.range(0), 0xA5);
+  std::vector<uint8_t> rx(state.range(0));
+
+  for (auto _ : state) {
+    if (waveform) {
+      api.transaction(tx.data(), rx.data(), tx.size());
+    } else {
+      api.select();
+      api.transfer(tx.data(), rx.data(), tx.size());
+      api.deselect();
+    }
+    benchmark::DoNotOptimize(rx.data());
+  }
+  reportPerByte(state);
+}
+BENCHMARK(BM_ChipSpiApiTransaction)
+    ->ArgNames({"bytes", "waveform"})
+    ->ArgsProduct({{2, 18, 130}, {0, 1}});
+
+/**
+ * @brief Statically specialized basic_chip_spi, fully inlined bit loop.
+ */
+static void BM_BasicChipSpiTransfer(benchmark::State &state) {
+  using pins = static_spi_pins<fast_gpio_driver::CS, fast_gpio_driver::SCK,
+                               fast_gpio_driver::MOSI, fast_gpio_driver::MISO>;
+
+  fast_gpio_driver gpio;
+  basic_chip_spi<fast_gpio_driver, pins, spi_no_delay> spi(gpio);
+
+  std::vector<uint8_t> tx(state.range(0), 0xA5);
+  std::vector<uint8_t> rx(state.range(0));
+
+  for (auto _ : state) {
+    spi.transfer(tx.data(), rx.data(), tx.size());
+    benchmark::DoNotOptimize(rx.data());
+  }
+  reportPerByte(state);
+}
+BENCHMARK(BM_BasicChipSpiTransfer)->Arg(1)->Arg(16)->Arg(512);
+
+/**
+ * @brief eeprom_api wired to a 25LC040A model with no write cycle delay.
+ */
+struct eeprom_bench_rig {
+  eeprom_model model;
+  chip_spi_api spi;
+  eeprom_api eeprom;
+
+  eeprom_bench_rig()
+      : model(config()), spi(model, 0, 1, 2, 3,
+                             spi_timing(spi_timing::mode::none)),
+        eeprom(spi) {}
+
+  static eeprom_model_config config() {
+    eeprom_model_config result;
+    result.writeCycle = std::chrono::microseconds(0);
+    return result;
+  }
+};
+
+/**
+ * @brief Report payload throughput and GPIO operations per payload byte.
+ * @param state Benchmark state
+ * @param model Model that counted the pin operations
+ */
+static void reportBusEfficiency(benchmark::State &state,
+                                const spi_device_model &model) {
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  state.counters["gpio_per_byte"] = benchmark::Counter(
+      static_cast<double>(model.pinWrites() + model.pinReads()) /
+          static_cast<double>(state.range(0)),
+      benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * @brief Byte-at-a-time reads over consecutive addresses.
+ */
+static void BM_EepromReadByte(benchmark::State &state) {
+  eeprom_bench_rig rig;
+  rig.model.resetCounters();
+
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i)
+      benchmark::DoNotOptimize(rig.eeprom.readByte(i));
+  }
+  reportBusEfficiency(state, rig.model);
+}
+BENCHMARK(BM_EepromReadByte)->RangeMultiplier(4)->Range(1, 512);
+
+/**
+ * @brief Single sequential buffer read.
+ */
+static void BM_EepromReadBuffer(benchmark::State &state) {
+  eeprom_bench_rig rig;
+  std::vector<uint8_t> buffer(state.range(0));
+  rig.model.resetCounters();
+
+  for (auto _ : state) {
+    rig.eeprom.readBuffer(0, buffer.data(), buffer.size());
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  reportBusEfficiency(state, rig.model);
+}
+BENCHMARK(BM_EepromReadBuffer)->RangeMultiplier(4)->Range(1, 512);
+
+/**
+ * @brief Page-split buffer write.
+ */
+static void BM_EepromWriteBuffer(benchmark::State &state) {
+  eeprom_bench_rig rig;
+  std::vector<uint8_t> buffer(state.range(0));
+  rig.model.resetCounters();
+
+  uint8_t fill = 0;
+  for (auto _ : state) {
+    std::fill(buffer.begin(), buffer.end(), fill++);
+    rig.eeprom.writeBuffer(0, buffer.data(), buffer.size());
+  }
+  reportBusEfficiency(state, rig.model);
+}
+BENCHMARK(BM_EepromWriteBuffer)->RangeMultiplier(4)->Range(1, 512);
+
+/**
+ * @brief One bit flipped in each of consecutive bytes.
+ */
+static void BM_EepromWriteBit(benchmark::State &state) {
+  eeprom_bench_rig rig;
+  rig.model.resetCounters();
+
+  bool value = false;
+  for (auto _ : state) {
+    value = !value;
+    for (int64_t i = 0; i < state.range(0); ++i)
+      rig.eeprom.writeBit(i, 3, value);
+  }
+  reportBusEfficiency(state, rig.model);
+}
+BENCHMARK(BM_EepromWriteBit)->RangeMultiplier(4)->Range(1, 512);
+
+/**
+ * @brief Bulk NOR read in each output mode, arg 1 selects the mode.
+ */
+static void BM_NorReadBuffer(benchmark::State &state) {
+  nor_flash_model_config config;
+  config.capacity = 1024 * 1024;
+  config.quadEnable = true;
+  config.pins.io2 = 4;
+  config.pins.io3 = 5;
+
+  nor_flash_model model(config);
+  chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+  spi.setDataLines(4, 4, 5);
+  nor_flash_api flash(spi, config.capacity);
+  flash.setReadMode(static_cast<nor_read_mode>(state.range(1)));
+
+  std::vector<uint8_t> buffer(state.range(0));
+  model.resetCounters();
+
+  for (auto _ : state) {
+    flash.readBuffer(0, buffer.data(), buffer.size());
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  reportBusEfficiency(state, model);
+}
+BENCHMARK(BM_NorReadBuffer)
+    ->ArgNames({"bytes", "mode"})
+    ->ArgsProduct({{256, 4096}, {0, 1, 2, 3}});
+
+/**
+ * @brief Page writes striped over arg 0 chips with a 1 ms write cycle.
+ *
+ * Wall time is dominated by the write cycles, so bytes/s should
+ * grow with the chip count.
+ */
+static void BM_StripedWriteBuffer(benchmark::State &state) {
+  const std::size_t count = state.range(0);
+  spi_model_bus wires;
+  spi_bus bus(wires, 1, 2, 3, spi_timing(spi_timing::mode::none));
+  std::vector<std::unique_ptr<eeprom_model>> models;
+  std::vector<std::unique_ptr<eeprom_api>> chips;
+  std::vector<eeprom_api *> drivers;
+
+  for (std::size_t k = 0; k < count; ++k) {
+    eeprom_model_config config;
+    config.writeCycle = std::chrono::microseconds(1000);
+    config.pins.cs = static_cast<int>(4 + k);
+    models.push_back(std::make_unique<eeprom_model>(config));
+    wires.attach(*models.back());
+  }
+  for (std::size_t k = 0; k < count; ++k) {
+    chips.push_back(
+        std::make_unique<eeprom_api>(bus.attach(static_cast<int>(4 + k))));
+    drivers.push_back(chips.back().get());
+  }
+
+  striped_memory_device striped(drivers);
+  std::vector<uint8_t> data(striped.capacity(), 0x5A);
+
+  for (auto _ : state) {
+    striped.writeBuffer(0, data.data(), data.size());
+    striped.sync();
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_StripedWriteBuffer)
+    ->ArgName("chips")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief Asynchronous front end with a background worker owning the device.
+ *
+ * Writes are queued and return immediately with a future or a
+ * completion callback. A dedicated worker thread drains the queue,
+ * merging overlapping and adjacent writes into contiguous buffer
+ * writes, so the device can program them page by page and do its
+ * WIP polling off the caller's thread.
+ *
+ * Reads are served ahead of queued writes, with the data of every
+ * write submitted before them overlaid on the device contents, so
+ * a caller always reads its own writes. Queued reads that overlap
+ * or touch are served by one device read, each caller getting its
+ * slice, so neighbouring fields read by several threads cost one
+ * READ transaction instead of one each.
+ *
+ * Addresses wrap at the end of the device like device reads and
+ * writes do, so overlays and merges work on ranges reduced modulo
+ * the device size.
+ *
+ * All methods are thread-safe. An optional merge window holds the
+ * worker back for a moment after a request arrives on an empty
+ * queue, letting requests from other threads join the batch.
+ */
+class async_memory_device {
+public:
+  /// Callback invoked on the worker thread once a request is done
+  using completion = std::function<void()>;
+
+  /**
+   * @brief Construct the front end and start the worker thread.
+   * @param device Device owned by the worker from now on
+   * @param mergeWindow Time the worker waits for more requests, 0 = none
+   * @param capacity Device size in bytes
+   */
+  explicit async_memory_device(
+      i_memory_device_api &device,
+      std::chrono::microseconds mergeWindow = std::chrono::microseconds(0),
+      std::size_t capacity = eeprom_api::MEMORY_SIZE);
+
+  /**
+   * @brief Drain the queue and stop the worker thread.
+   */
+  ~async_memory_device();
+
+  async_memory_device(const async_memory_device &) = delete;
+  async_memory_device &operator=(const async_memory_device &) = delete;
+
+  /**
+   * @brief Queue a single byte write.
+   * @param address Memory address to write to
+   * @param data Byte to write
+   * @return std::future<void> Ready once the byte is programmed
+   */
+  std::future<void> writeByte(uint16_t address, uint8_t data);
+
+  /**
+   * @brief Queue a buffer write.
+   * @param address Starting memory address
+   * @param data Pointer to data buffer, copied before returning
+   * @param length Number of bytes to write
+   * @return std::future<void> Ready once the data is programmed
+   */
+  std::future<void> writeBuffer(uint16_t address, const uint8_t *data,
+                                std::size_t length);
+
+  /**
+   * @brief Queue a buffer write with a completion callback.
+   * @param address Starting memory address
+   * @param data Pointer to data buffer, copied before returning
+   * @param length Number of bytes to write
+   * @param done Called on the worker thread once the data is programmed
+   */
+  void writeBuffer(uint16_t address, const uint8_t *data, std::size_t length,
+                   completion done);
+
+  /**
+   * @brief Read a single byte, seeing all previously queued writes.
+   * @param address Memory address to read
+   * @return uint8_t Value read from memory
+   */
+  uint8_t readByte(uint16_t address);
+
+  /**
+   * @brief Read a buffer, seeing all previously queued writes.
+   * @param address Starting memory address
+   * @param buffer Pointer to buffer to store data
+   * @param length Number of bytes to read
+   */
+  void readBuffer(uint16_t address, uint8_t *buffer, std::size_t length);
+
+  /**
+   * @brief Block until every queued request has completed.
+   */
+  void drain();
+
+  /**
+   * @brief Get the number of device writes issued by the worker.
+   * @return uint64_t Merged write count
+   */
+  uint64_t deviceWrites() const;
+
+  /**
+   * @brief Get the number of device reads issued by the worker.
+   * @return uint64_t Merged read count
+   */
+  uint64_t deviceReads() const;
+
+  /**
+   * @brief Get the merge window.
+   * @return std::chrono::microseconds Time the worker waits for more requests
+   */
+  std::chrono::microseconds mergeWindow() const { return mergeWindow_; }
+
+private:
+  /**
+   * @brief Queued write request.
+   */
+  struct write_request {
+    uint64_t sequence;         ///< Submission order
+    uint16_t address;          ///< Starting memory address
+    std::vector<uint8_t> data; ///< Copy of the payload
+    std::promise<void> done;   ///< Fulfilled when programmed
+    completion callback;       ///< Optional completion callback
+  };
+
+  /**
+   * @brief Queued read request.
+   */
+  struct read_request {
+    uint64_t sequence;       ///< Writes before this one are visible
+    uint16_t address;        ///< Starting memory address
+    uint8_t *buffer;         ///< Caller's buffer
+    std::size_t length;      ///< Number of bytes to read
+    std::promise<void> done; ///< Fulfilled when the buffer is filled
+  };
+
+  /**
+   * @brief Contiguous range assembled from merged writes.
+   */
+  struct extent {
+    std::size_t address;       ///< Starting memory address
+    std::vector<uint8_t> data; ///< Merged payload
+  };
+
+  /**
+   * @brief Put a write on the queue and wake the worker.
+   * @param request Write request
+   */
+  void submit(write_request request);
+
+  /**
+   * @brief Note the arrival of a request; call with the mutex held.
+   */
+  void arrived();
+
+  /**
+   * @brief Worker thread main loop.
+   */
+  void run();
+
+  /**
+   * @brief Read a batch with one device read per contiguous span.
+   * @param batch Reads, sorted by address on return
+   * @return uint64_t Device reads issued
+   */
+  uint64_t fetch(std::vector<read_request> &batch);
+
+  /**
+   * @brief Complete a fetched read by overlaying pending writes.
+   * @param request Read request
+   */
+  void serve(read_request &request);
+
+  /**
+   * @brief Merge a batch of writes and hand it to the device.
+   * @param batch Writes in submission order
+   */
+  void flush(std::vector<write_request> &batch);
+
+  /**
+   * @brief Copy the part of a write that overlaps a read range.
+   * @param write Pending write
+   * @param address Start of the read range
+   * @param buffer Read buffer
+   * @param length Length of the read range
+   */
+  void overlay(const write_request &write, std::size_t address,
+               uint8_t *buffer, std::size_t length) const;
+
+  /**
+   * @brief Fold one non-wrapping write segment into the extents.
+   * @param extents Extents built so far, disjoint and not touching
+   * @param address Start of the segment, below the device size
+   * @param data Segment bytes
+   * @param length Segment length, not past the end of the device
+   */
+  static void fold(std::vector<extent> &extents, std::size_t address,
+                   const uint8_t *data, std::size_t length);
+
+private:
+  i_memory_device_api &device_;          ///< Device owned by the worker
+  std::chrono::microseconds mergeWindow_; ///< Batching delay
+  std::size_t capacity_;                  ///< Device size in bytes
+
+  mutable std::mutex mutex_;         ///< Guards everything below
+  std::condition_variable wake_;     ///< Signals new work or stop
+  std::condition_variable idle_;     ///< Signals an empty, idle queue
+  std::deque<write_request> writes_; ///< Pending writes
+  std::deque<read_request> reads_;   ///< Pending reads
+  uint64_t sequence_ = 0;            ///< Next submission number
+  uint64_t deviceWrites_ = 0;        ///< Merged writes issued
+  uint64_t deviceReads_ = 0;         ///< Merged reads issued
+  /// Arrival of the request that found the queue empty
+  std::chrono::steady_clock::time_point firstArrival_;
+  bool busy_ = false;                ///< Worker is executing a request
+  bool stop_ = false;                ///< Worker should exit
+
+  std::thread worker_; ///< Thread owning the device
+};
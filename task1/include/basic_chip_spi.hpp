@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "spi_timing.hpp"
+#include "telemetry.hpp"
+
+/**
+ * @brief SPI pin assignment known only at run time.
+ */
+struct spi_pin_map {
+  int cs;   ///< Chip select pin
+  int sck;  ///< Clock pin
+  int mosi; ///< MOSI pin
+  int miso; ///< MISO pin
+};
+
+/**
+ * @brief SPI pin assignment fixed at compile time.
+ *
+ * Exposes the same members as spi_pin_map, so basic_chip_spi
+ * reads both the same way while the compiler folds these
+ * into immediates.
+ */
+template <int CS, int SCK, int MOSI, int MISO> struct static_spi_pins {
+  static constexpr int cs = CS;     ///< Chip select pin
+  static constexpr int sck = SCK;   ///< Clock pin
+  static constexpr int mosi = MOSI; ///< MOSI pin
+  static constexpr int miso = MISO; ///< MISO pin
+};
+
+/**
+ * @brief Bit-banged SPI master specialized on driver, pins and timing.
+ *
+ * Header-only so that, with a final GPIO driver type, static pins
+ * and spi_no_delay, the whole 8-bit loop inlines into straight-line
+ * GPIO accesses. chip_spi_api wraps the run-time instantiation
+ * behind i_chip_spi_api.
+ *
+ * @tparam Gpio GPIO driver type (setHigh/setLow/read, mask operations)
+ * @tparam Pins spi_pin_map or a static_spi_pins instantiation
+ * @tparam Timing Delay policy providing halfPeriod()
+ * @tparam Counters Telemetry policy, spi_counters or spi_no_counters
+ */
+template <class Gpio, class Pins, class Timing = spi_timing,
+          class Counters = spi_no_counters>
+class basic_chip_spi {
+public:
+  /**
+   * @brief Construct the SPI master and put the bus into idle state.
+   * @param gpio Reference to GPIO driver
+   * @param pins Pin assignment
+   * @param timing Delay policy between SCK edges
+   */
+  explicit basic_chip_spi(Gpio &gpio, Pins pins = Pins{},
+                          Timing timing = Timing{})
+      : gpio_(gpio), pins_(pins), timing_(timing) {
+    portAccess_ = gpio_.hasPortAccess() && fitsMask(pins_.sck) &&
+                  fitsMask(pins_.mosi);
+
+    deselect();
+    gpio_.setLow(pins_.sck);
+  }
+
+  /**
+   * @brief Select the device by pulling CS low.
+   *
+   * With a negative CS pin the caller drives CS itself, as
+   * spi_bus does for the chips sharing the lines; only the
+   * transaction is counted.
+   */
+  void select() {
+    counters_.onTransaction();
+    if (pins_.cs < 0)
+      return;
+    gpio_.setLow(pins_.cs);
+    counters_.onGpio(1);
+  }
+
+  /**
+   * @brief Deselect the device by pulling CS high.
+   */
+  void deselect() {
+    if (pins_.cs < 0)
+      return;
+    gpio_.setHigh(pins_.cs);
+    counters_.onGpio(1);
+  }
+
+  /**
+   * @brief Transfer a byte, MSB first.
+   * @param data Byte to send
+   * @return uint8_t Received byte
+   */
+  uint8_t transfer(uint8_t data) {
+    uint8_t result = shiftByte(data);
+    releaseClock();
+    flushCounters(1);
+    return result;
+  }
+
+  /**
+   * @brief Transfer a buffer in full duplex.
+   * @param tx Bytes to send, or nullptr to send 0x00
+   * @param rx Buffer for received bytes, or nullptr to discard them
+   * @param length Number of bytes to transfer
+   */
+  void transfer(const uint8_t *tx, uint8_t *rx, std::size_t length) {
+    for (std::size_t i = 0; i < length; ++i) {
+      uint8_t data = shiftByte(tx ? tx[i] : 0x00);
+      if (rx)
+        rx[i] = data;
+    }
+    releaseClock();
+    flushCounters(length);
+  }
+
+  /**
+   * @brief Clock SCK without sampling, for dummy cycles.
+   * @param cycles Number of SCK cycles
+   */
+  void clockCycles(unsigned cycles) {
+    for (unsigned i = 0; i < cycles; ++i)
+      clockEdges();
+    releaseClock();
+  }
+
+  /**
+   * @brief Clock bytes in on several data lines at once.
+   *
+   * Each SCK cycle samples width lines; io[k] carries bit k of
+   * every group, so on 4 lines IO3 holds bit 7 of the first
+   * cycle, as in the serial flash Dual/Quad Output reads. The
+   * caller turns the lines around to input first.
+   *
+   * @param io Data pins, io[0] is the lowest bit of each group
+   * @param width Number of data lines, 2 or 4
+   * @param rx Buffer for received bytes
+   * @param length Number of bytes to receive
+   */
+  void receiveLines(const int *io, unsigned width, uint8_t *rx,
+                    std::size_t length) {
+    const unsigned groups = 8 / width;
+
+    // one port read per cycle when every line fits the mask
+    bool portRead = portAccess_;
+    uint32_t ioMask = 0;
+    for (unsigned k = 0; k < width; ++k) {
+      portRead = portRead && fitsMask(io[k]);
+      ioMask |= uint32_t{1} << (io[k] & 31);
+    }
+
+    for (std::size_t i = 0; i < length; ++i) {
+      uint8_t result = 0;
+      for (unsigned g = 0; g < groups; ++g) {
+        clockEdges();
+        if (portRead) {
+          uint32_t levels = gpio_.readMask(ioMask);
+          for (unsigned k = width; k-- > 0;)
+            result = (result << 1) | ((levels >> io[k]) & 0x1);
+        } else {
+          for (unsigned k = width; k-- > 0;)
+            result = (result << 1) | (gpio_.read(io[k]) ? 1 : 0);
+        }
+      }
+      rx[i] = result;
+    }
+    releaseClock();
+    flushCounters(length);
+  }
+
+  /**
+   * @brief Access the telemetry counters.
+   * @return const Counters& Counter policy instance
+   */
+  const Counters &counters() const { return counters_; }
+
+  /**
+   * @brief Access the telemetry counters for reset.
+   * @return Counters& Counter policy instance
+   */
+  Counters &counters() { return counters_; }
+
+private:
+  /**
+   * @brief Tell whether a pin can be addressed in a 32-bit port mask.
+   * @param pin Pin number
+   * @return true if 0 <= pin < 32
+   */
+  static constexpr bool fitsMask(int pin) { return pin >= 0 && pin < 32; }
+
+  /**
+   * @brief Clock one bit out on MOSI and in from MISO (mode 0).
+   *
+   * MOSI changes while SCK is low and MISO is sampled once SCK
+   * has risen. SCK is left high: the falling edge is deferred
+   * to the next bit, where a port-capable driver merges it with
+   * the MOSI update into one write.
+   *
+   * @param bit Bit value to write (true=1, false=0)
+   * @return true if the received bit is 1, false if 0
+   */
+  bool clockBit(bool bit) {
+    const uint32_t maskSCK = uint32_t{1} << (pins_.sck & 31);
+    const uint32_t maskMOSI = uint32_t{1} << (pins_.mosi & 31);
+
+    if (portAccess_) {
+      gpio_.writePort(maskSCK | maskMOSI, bit ? maskMOSI : 0);
+      countGpio(2);
+    } else {
+      countGpio(sckHigh_ ? 3 : 2);
+      if (sckHigh_)
+        gpio_.setLow(pins_.sck);
+      if (bit)
+        gpio_.setHigh(pins_.mosi);
+      else
+        gpio_.setLow(pins_.mosi);
+    }
+
+    timing_.halfPeriod();
+
+    if (portAccess_)
+      gpio_.setMask(maskSCK);
+    else
+      gpio_.setHigh(pins_.sck);
+    sckHigh_ = true;
+
+    timing_.halfPeriod();
+
+    return gpio_.read(pins_.miso);
+  }
+
+  /**
+   * @brief Run one SCK cycle with the data lines left alone.
+   *
+   * Same edge order as clockBit(): the deferred falling edge,
+   * half a period, the rising edge, half a period.
+   */
+  void clockEdges() {
+    if (sckHigh_) {
+      gpio_.setLow(pins_.sck);
+      countGpio(1);
+    }
+    timing_.halfPeriod();
+    gpio_.setHigh(pins_.sck);
+    countGpio(1);
+    sckHigh_ = true;
+    timing_.halfPeriod();
+  }
+
+  /**
+   * @brief Return SCK to idle low after the last clocked bit.
+   */
+  void releaseClock() {
+    if (!sckHigh_)
+      return;
+
+    gpio_.setLow(pins_.sck);
+    sckHigh_ = false;
+    countGpio(1);
+  }
+
+  /**
+   * @brief Tally GPIO writes locally until the call completes.
+   *
+   * Keeps atomics out of the bit loop; without telemetry the
+   * whole tally compiles away.
+   *
+   * @param n Number of GPIO writes
+   */
+  void countGpio(uint32_t n) {
+    if constexpr (Counters::enabled)
+      pendingGpio_ += n;
+  }
+
+  /**
+   * @brief Publish the tallies of one transfer call.
+   * @param bytes Number of bytes clocked
+   */
+  void flushCounters(std::size_t bytes) {
+    if constexpr (Counters::enabled) {
+      counters_.onBytes(bytes);
+      counters_.onGpio(pendingGpio_);
+      pendingGpio_ = 0;
+    }
+  }
+
+  /**
+   * @brief Shift a byte out and in without releasing SCK.
+   * @param data Byte to send
+   * @return uint8_t Received byte
+   */
+  uint8_t shiftByte(uint8_t data) {
+    uint8_t result = 0;
+    for (int i = 7; i >= 0; --i) {
+      bool bitToSend = (data >> i) & 0x1;
+      bool bitReceived = clockBit(bitToSend);
+      result = (result << 1) | (bitReceived ? 1 : 0);
+    }
+    return result;
+  }
+
+private:
+  Gpio &gpio_;    ///< Reference to GPIO driver
+  Pins pins_;     ///< Pin assignment
+  Timing timing_; ///< Delay policy between SCK edges
+
+  bool portAccess_ = false; ///< Drive SCK and MOSI with one port write
+  bool sckHigh_ = false;    ///< SCK is still high after the last bit
+
+  [[no_unique_address]] Counters counters_; ///< Telemetry policy
+  uint64_t pendingGpio_ = 0; ///< GPIO writes not yet published
+};
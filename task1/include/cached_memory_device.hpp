@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief Write-back RAM cache in front of a memory device.
+ *
+ * Keeps a full image of the device, loaded with one sequential
+ * read on first access, and serves every read from it. Writes
+ * only touch the image and mark their pages dirty; flush() writes
+ * back runs of dirty pages, so thousands of small updates turn
+ * into a handful of page writes.
+ */
+class cached_memory_device final : public i_memory_device_api {
+public:
+  /**
+   * @brief Construct a cache over a memory device.
+   * @param device Backing device
+   * @param flushThreshold Dirty page count that triggers flush(), 0 = never
+   * @param capacity Device size in bytes, a multiple of pageSize, at most
+   * 64 KB
+   * @param pageSize Device write page size in bytes
+   * @throw std::invalid_argument if the geometry is not usable
+   */
+  explicit cached_memory_device(i_memory_device_api &device,
+                                std::size_t flushThreshold = 0,
+                                std::size_t capacity = eeprom_api::MEMORY_SIZE,
+                                std::size_t pageSize = eeprom_api::PAGE_SIZE);
+
+  /**
+   * @brief Write back any dirty pages before the cache goes away.
+   */
+  ~cached_memory_device() override;
+
+  void writeByte(uint16_t address, uint8_t data) override;
+  uint8_t readByte(uint16_t address) override;
+
+  void writeBuffer(uint16_t address, const uint8_t *data,
+                   std::size_t length) override;
+  void readBuffer(uint16_t address, uint8_t *buffer,
+                  std::size_t length) override;
+
+  void writeBit(uint16_t address, uint8_t bitPosition, bool value) override;
+  bool readBit(uint16_t address, uint8_t bitPosition) override;
+
+  /**
+   * @brief Write all dirty pages back to the device.
+   */
+  void flush();
+
+  /**
+   * @brief Get the number of pages waiting to be written back.
+   * @return std::size_t Dirty page count
+   */
+  std::size_t dirtyPages() const { return dirtyCount_; }
+
+private:
+  /**
+   * @brief Fill the image from the device if not done yet.
+   */
+  void load();
+
+  /**
+   * @brief Mark the pages covering a byte range as dirty.
+   * @param offset Image offset of the first byte
+   * @param length Number of bytes, must not wrap
+   */
+  void markDirty(std::size_t offset, std::size_t length);
+
+  /**
+   * @brief Tell whether a page is dirty.
+   * @param page Page index
+   * @return true if the page has to be written back
+   */
+  bool isDirty(std::size_t page) const;
+
+  /**
+   * @brief Flush if the dirty page count reached the threshold.
+   */
+  void flushIfNeeded();
+
+private:
+  i_memory_device_api &device_; ///< Backing device
+
+  std::vector<uint8_t> image_;  ///< RAM copy of the device
+  std::vector<uint32_t> dirty_; ///< Dirty bitmap, one bit per page
+
+  std::size_t pageSize_;       ///< Write page size in bytes
+  std::size_t flushThreshold_; ///< Auto-flush limit, 0 = never
+  std::size_t dirtyCount_ = 0; ///< Number of set bits in dirty_
+  bool loaded_ = false;        ///< image_ holds device contents
+};
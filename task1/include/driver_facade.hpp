@@ -1,7 +1,15 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 
+#include "basic_chip_spi.hpp"
+#include "eeprom_chip.hpp"
+#include "spi_timing.hpp"
+#include "spi_waveform.hpp"
+#include "telemetry.hpp"
+
 /**
  * @brief Interface for GPIO driver used for bit-banging SPI.
  */
@@ -25,6 +33,74 @@ struct i_chip_gpio_driver {
    */
   virtual bool read(int pin) = 0;
 
+  /*
+   * optional port-wide operations,
+   * bit n of a mask stands for pin n
+   * */
+
+  /**
+   * @brief Tell whether the mask operations are native port writes.
+   * @return true if setMask/clearMask/writePort take a single write
+   */
+  virtual bool hasPortAccess() const { return false; }
+
+  /**
+   * @brief Set every pin in the mask high.
+   * @param mask Pin mask
+   */
+  virtual void setMask(uint32_t mask);
+
+  /**
+   * @brief Set every pin in the mask low.
+   * @param mask Pin mask
+   */
+  virtual void clearMask(uint32_t mask);
+
+  /**
+   * @brief Drive the masked pins to the given levels in one go.
+   * @param mask Pin mask
+   * @param values Levels for the masked pins
+   */
+  virtual void writePort(uint32_t mask, uint32_t values);
+
+  /**
+   * @brief Read the levels of every pin in a mask in one go.
+   * @param mask Pin mask
+   * @return uint32_t Levels, bit n for pin n, zero outside mask
+   */
+  virtual uint32_t readMask(uint32_t mask);
+
+  /**
+   * @brief Switch a pin between output and input.
+   *
+   * Needed to turn shared data lines around for dual and quad
+   * transfers. The default does nothing, for drivers whose pins
+   * are always bidirectional.
+   *
+   * @param pin Pin number
+   * @param output true to drive the pin, false to release it
+   */
+  virtual void setDirection(int /*pin*/, bool /*output*/) {}
+
+  /**
+   * @brief Play a precompiled waveform in one call.
+   *
+   * Each edge is one port write; after every edge flagged for
+   * sampling the pins in sampleMask are read, and the sampled
+   * bits are packed MSB first into rxOut, a bit being 1 if any
+   * of those pins is high. The default implementation goes
+   * through writePort() and readMask(); backends that can replay
+   * the list from a tight loop or DMA should override it.
+   *
+   * @param edges Edge list, see spi_waveform
+   * @param count Number of edges
+   * @param sampleMask Input pins to sample
+   * @param rxOut Buffer for one byte per 8 samples, or nullptr to
+   * skip sampling
+   */
+  virtual void submit(const gpio_edge *edges, std::size_t count,
+                      uint32_t sampleMask, uint8_t *rxOut);
+
   virtual ~i_chip_gpio_driver() = default;
 };
 
@@ -48,6 +124,18 @@ public:
   virtual void select() = 0;
   virtual void deselect() = 0;
 
+  /**
+   * @brief Tell whether another chip took the bus since select().
+   *
+   * On a shared bus selecting another chip ends the transaction
+   * of this one, so a driver keeping a transaction open between
+   * calls has to start a new one. The default is false, for
+   * transports that own their bus.
+   *
+   * @return true if the last select() no longer holds
+   */
+  virtual bool preempted() const { return false; }
+
   /*
    * SPI assume data transfers by bits,
    * but we need byte transfer interface
@@ -62,11 +150,84 @@ public:
    */
   virtual uint8_t transfer(uint8_t data) = 0;
 
+  /**
+   * @brief Transfer a buffer over SPI in full duplex.
+   *
+   * The default implementation falls back to the byte-level
+   * transfer(); backends that can move a whole transaction
+   * at once should override it.
+   *
+   * @param tx Bytes to send, or nullptr to send 0x00
+   * @param rx Buffer for received bytes, or nullptr to discard them
+   * @param length Number of bytes to transfer
+   */
+  virtual void transfer(const uint8_t *tx, uint8_t *rx, std::size_t length);
+
+  /**
+   * @brief Send a buffer over SPI, discarding received bytes.
+   * @param tx Bytes to send
+   * @param length Number of bytes to send
+   */
+  void send(const uint8_t *tx, std::size_t length) {
+    transfer(tx, nullptr, length);
+  }
+
+  /**
+   * @brief Receive a buffer over SPI while sending 0x00.
+   * @param rx Buffer for received bytes
+   * @param length Number of bytes to receive
+   */
+  void receive(uint8_t *rx, std::size_t length) {
+    transfer(nullptr, rx, length);
+  }
+
+  /**
+   * @brief Get the number of data lines the bus can read on at once.
+   * @return unsigned 1, 2 or 4
+   */
+  virtual unsigned dataLines() const { return 1; }
+
+  /**
+   * @brief Receive a buffer on several data lines at once.
+   *
+   * Turns the data lines around to input, clocks dummyCycles
+   * turnaround cycles, then clocks in length bytes at width
+   * bits per SCK cycle. The lines return to normal on deselect.
+   * The default implementation only handles width 1 and clocks
+   * the dummy cycles as whole bytes, so it needs dummyCycles to
+   * be a multiple of 8; callers check dataLines() before asking
+   * for more lines.
+   *
+   * @param rx Buffer for received bytes
+   * @param length Number of bytes to receive
+   * @param width Data lines to use, at most dataLines()
+   * @param dummyCycles SCK cycles between address and data
+   */
+  virtual void receiveWide(uint8_t *rx, std::size_t length, unsigned width,
+                           unsigned dummyCycles);
+
+  /**
+   * @brief Run a whole transaction: select, transfer, deselect.
+   *
+   * The default implementation makes the three calls; backends
+   * that can hand the complete waveform over at once should
+   * override it.
+   *
+   * @param tx Bytes to send, or nullptr to send 0x00
+   * @param rx Buffer for received bytes, or nullptr to discard them
+   * @param length Number of bytes to transfer
+   */
+  virtual void transaction(const uint8_t *tx, uint8_t *rx,
+                           std::size_t length);
+
   virtual ~i_chip_spi_api() = default;
 };
 
 /**
  * @brief Concrete SPI implementation using GPIO bit-banging.
+ *
+ * Thin type-erased wrapper over basic_chip_spi instantiated
+ * with the virtual GPIO driver and run-time pins and timing.
  */
 class chip_spi_api final : public i_chip_spi_api {
 public:
@@ -77,93 +238,338 @@ public:
    * @param pinSCK SPI clock pin
    * @param pinMOSI SPI MOSI pin
    * @param pinMISO SPI MISO pin
+   * @param timing Delay policy between SCK edges
    */
   chip_spi_api(i_chip_gpio_driver &gpio, int pinCS, int pinSCK, int pinMOSI,
-               int pinMISO);
+               int pinMISO, spi_timing timing = spi_timing());
 
   void select() override;
   void deselect() override;
   uint8_t transfer(uint8_t data) override;
+  void transfer(const uint8_t *tx, uint8_t *rx, std::size_t length) override;
+  void transaction(const uint8_t *tx, uint8_t *rx,
+                   std::size_t length) override;
 
-private:
-  /*
-   * SPI primitives
-   * */
+  /**
+   * @brief Get the bus counters.
+   *
+   * Safe to call from another thread; reads zero when built
+   * without DRIVER_FACADE_TELEMETRY.
+   *
+   * @return spi_telemetry Snapshot of the counters
+   */
+  spi_telemetry telemetry() const { return spi_.counters().snapshot(); }
 
   /**
-   * @brief Generate a clock pulse on SCK.
+   * @brief Configure the number of data lines for wide reads.
+   *
+   * With 2 lines, MOSI and MISO double as IO0 and IO1; 4 lines
+   * also need the IO2 (/WP) and IO3 (/HOLD) pins, which idle as
+   * driven-high outputs outside wide reads.
+   *
+   * @param lines 1, 2 or 4
+   * @param pinIO2 IO2 pin, used with 4 lines
+   * @param pinIO3 IO3 pin, used with 4 lines
    */
-  void clockPulse();
+  void setDataLines(unsigned lines, int pinIO2 = -1, int pinIO3 = -1);
+
+  unsigned dataLines() const override { return lines_; }
+  void receiveWide(uint8_t *rx, std::size_t length, unsigned width,
+                   unsigned dummyCycles) override;
 
   /**
-   * @brief Write a single bit over SPI.
-   * @param bit Bit value to write (true=1, false=0)
+   * @brief Reset the bus counters.
    */
-  void writeBit(bool bit);
+  void resetTelemetry() { spi_.counters().reset(); }
 
+private:
   /**
-   * @brief Read a single bit from SPI.
-   * @return true if bit is 1, false if 0
+   * @brief Drive the data lines again after a wide read.
    */
-  bool readBit();
+  void restoreLines();
 
 private:
-  i_chip_gpio_driver &m_gpio; ///< Reference to GPIO driver
+  i_chip_gpio_driver &gpio_;  ///< GPIO driver, for line turnaround
+  int io_[4];                 ///< IO0 (MOSI), IO1 (MISO), IO2, IO3
+  unsigned lines_ = 1;        ///< Data lines available for wide reads
+  bool turnedAround_ = false; ///< Data lines are inputs for a wide read
+
+  spi_waveform waveform_;    ///< Compiler of whole transactions
+  uint32_t maskMISO_ = 0;    ///< MISO pin mask for waveform samples
+  bool useWaveform_ = false; ///< Transactions go through submit()
+
+  /// Bit-banging engine behind the virtual interface
+  basic_chip_spi<i_chip_gpio_driver, spi_pin_map, spi_timing,
+                 spi_default_counters>
+      spi_;
+};
 
-  int pinCS_;   ///< Chip select pin
-  int pinSCK_;  ///< Clock pin
-  int pinMOSI_; ///< MOSI pin
-  int pinMISO_; ///< MISO pin
+/**
+ * @brief Single bit assignment for batched bit updates.
+ * @tparam Address Device address type
+ */
+template <class Address> struct basic_bit_update {
+  Address address;     ///< Memory address of the byte
+  uint8_t bitPosition; ///< Bit index (0-7)
+  bool value;          ///< New bit value
 };
 
 /**
  * @brief Generic memory device interface (EEPROM/NOR etc.).
  *
  * Defines the standard read/write API for memory devices.
+ * Parametrized on the address type: 16 bits cover the 25xx
+ * EEPROMs, serial NOR needs 24-bit addresses.
+ *
+ * @tparam Address Device address type
  */
-class i_memory_device_api {
+template <class Address> class basic_memory_device_api {
 public:
-  virtual void writeByte(uint16_t address, uint8_t data) = 0;
-  virtual uint8_t readByte(uint16_t address) = 0;
+  using address_type = Address; ///< Device address type
+
+  virtual void writeByte(Address address, uint8_t data) = 0;
+  virtual uint8_t readByte(Address address) = 0;
 
-  virtual void writeBuffer(uint16_t address, const uint8_t *data,
+  virtual void writeBuffer(Address address, const uint8_t *data,
                            std::size_t length) = 0;
-  virtual void readBuffer(uint16_t address, uint8_t *buffer,
+  virtual void readBuffer(Address address, uint8_t *buffer,
                           std::size_t length) = 0;
 
-  virtual void writeBit(uint16_t address, uint8_t bitPosition, bool value) = 0;
-  virtual bool readBit(uint16_t address, uint8_t bitPosition) = 0;
+  virtual void writeBit(Address address, uint8_t bitPosition, bool value) = 0;
+  virtual bool readBit(Address address, uint8_t bitPosition) = 0;
+
+  /**
+   * @brief Replace the masked bits of a byte in one read-modify-write.
+   *
+   * The default implementation goes through readByte() and
+   * writeByte() and skips the write if nothing changes.
+   *
+   * @param address Memory address
+   * @param mask Bits to update
+   * @param values New values for the masked bits
+   */
+  virtual void updateBits(Address address, uint8_t mask, uint8_t values);
+
+  /**
+   * @brief Apply a batch of bit assignments.
+   *
+   * Updates to the same address are applied in order, so the
+   * last one wins. The default implementation issues one
+   * updateBits() per entry.
+   *
+   * @param updates Pointer to bit assignments
+   * @param count Number of bit assignments
+   */
+  virtual void updateBits(const basic_bit_update<Address> *updates,
+                          std::size_t count);
+
+  virtual ~basic_memory_device_api() = default;
+};
+
+extern template class basic_memory_device_api<uint16_t>;
+extern template class basic_memory_device_api<uint32_t>;
+
+/// Bit assignment for devices with 16-bit addresses
+using bit_update = basic_bit_update<uint16_t>;
 
-  virtual ~i_memory_device_api() = default;
+/// Memory device with 16-bit addresses, the 25xx EEPROM family
+using i_memory_device_api = basic_memory_device_api<uint16_t>;
+
+/**
+ * @brief Write cycle counters of an eeprom_api instance.
+ */
+struct eeprom_write_stats {
+  uint64_t writeCycles = 0;     ///< Internal write cycles started
+  uint64_t skippedCycles = 0;   ///< Page writes avoided as unchanged
+  uint64_t bytesProgrammed = 0; ///< Payload bytes sent with WRITE
+};
+
+/**
+ * @brief Ready-wait counters of an eeprom_api instance.
+ */
+struct eeprom_ready_stats {
+  uint64_t waits = 0;                 ///< Write cycles waited for
+  uint64_t polls = 0;                 ///< Status register reads
+  std::chrono::nanoseconds waited{0}; ///< Time blocked polling WIP
+  std::chrono::nanoseconds hidden{0}; ///< Write cycle time overlapped
 };
 
 /**
- * @brief EEPROM implementation of i_memory_device_api using SPI.
+ * @brief 25xx EEPROM implementation of the memory device interface.
+ *
+ * Specialized on an eeprom_chip descriptor: capacity, page size,
+ * address encoding and tWC are constants of the instantiation,
+ * so each part gets its own hot path without run-time geometry.
+ * eeprom_api is the 25LC040A instantiation.
+ *
+ * @tparam Chip eeprom_chip instantiation describing the part
  */
-class eeprom_api final : public i_memory_device_api {
+template <class Chip>
+class basic_eeprom_api final
+    : public basic_memory_device_api<typename Chip::address_type> {
 public:
+  using chip_type = Chip;                           ///< Part descriptor
+  using address_type = typename Chip::address_type; ///< Device address type
+  using bit_update_type = basic_bit_update<address_type>; ///< Bit assignment
+
   /**
    * @brief Construct EEPROM API with SPI interface.
    * @param spi SPI interface reference
    */
-  explicit eeprom_api(i_chip_spi_api &spi);
+  explicit basic_eeprom_api(i_chip_spi_api &spi);
+
+  /**
+   * @brief Close a pending sequential read, if any.
+   */
+  ~basic_eeprom_api() override;
 
   /*
    * eeprom api we want to have
    * */
 
-  void writeByte(uint16_t address, uint8_t data) override;
-  uint8_t readByte(uint16_t address) override;
+  void writeByte(address_type address, uint8_t data) override;
+  uint8_t readByte(address_type address) override;
 
-  void writeBuffer(uint16_t address, const uint8_t *data,
+  void writeBuffer(address_type address, const uint8_t *data,
                    std::size_t length) override;
-  void readBuffer(uint16_t address, uint8_t *buffer,
+  void readBuffer(address_type address, uint8_t *buffer,
                   std::size_t length) override;
 
-  void writeBit(uint16_t address, uint8_t bitPosition, bool value) override;
-  bool readBit(uint16_t address, uint8_t bitPosition) override;
+  void writeBit(address_type address, uint8_t bitPosition,
+                bool value) override;
+  bool readBit(address_type address, uint8_t bitPosition) override;
+
+  void updateBits(address_type address, uint8_t mask,
+                  uint8_t values) override;
+  void updateBits(const bit_update_type *updates, std::size_t count) override;
+
+  /*
+   * device geometry
+   * */
+  static constexpr std::size_t MEMORY_SIZE = Chip::capacity; ///< Total, bytes
+  static constexpr std::size_t PAGE_SIZE = Chip::pageSize;   ///< Page, bytes
+
+  /// Datasheet maximum of the internal write cycle (tWC)
+  static constexpr std::chrono::microseconds WRITE_CYCLE_TIME =
+      Chip::writeCycle;
+
+  /**
+   * @brief Terminate the sequential read left open by the read API.
+   *
+   * Reads keep CS low after they return so that a read of the
+   * next address continues the same READ transaction. Any other
+   * command closes the stream automatically; call this to release
+   * the bus explicitly.
+   */
+  void endSequentialRead();
+
+  /**
+   * @brief Enable or disable the skip-unchanged write mode.
+   *
+   * When enabled, every page touched by a write is read back
+   * first and only the span that actually differs is programmed;
+   * pages that already hold the data cost no write cycle.
+   *
+   * @param enable true to compare before writing
+   */
+  void setSkipUnchanged(bool enable) { skipUnchanged_ = enable; }
+
+  /**
+   * @brief Tell whether the skip-unchanged write mode is enabled.
+   * @return true if writes compare before programming
+   */
+  bool skipUnchanged() const { return skipUnchanged_; }
+
+  /**
+   * @brief Get the write cycle counters.
+   * @return const eeprom_write_stats& Counters since the last reset
+   */
+  const eeprom_write_stats &writeStats() const { return writeStats_; }
+
+  /**
+   * @brief Reset the write cycle counters.
+   */
+  void resetWriteStats() { writeStats_ = {}; }
+
+  /**
+   * @brief Enable or disable the deferred ready-wait mode.
+   *
+   * When enabled, a write returns as soon as its command has been
+   * clocked out; the next operation that needs the chip polls WIP
+   * first. Disabling the mode waits for a pending write cycle.
+   *
+   * @param enable true to defer the ready-wait
+   */
+  void setDeferredReady(bool enable);
+
+  /**
+   * @brief Tell whether the deferred ready-wait mode is enabled.
+   * @return true if writes return before their write cycle ends
+   */
+  bool deferredReady() const { return deferredReady_; }
+
+  /**
+   * @brief Wait for a deferred write cycle to finish, if one is pending.
+   */
+  void sync();
+
+  /**
+   * @brief Get the ready-wait counters.
+   * @return const eeprom_ready_stats& Counters since the last reset
+   */
+  const eeprom_ready_stats &readyStats() const { return readyStats_; }
+
+  /**
+   * @brief Reset the ready-wait counters.
+   */
+  void resetReadyStats() { readyStats_ = {}; }
+
+  /**
+   * @brief Get the learned write cycle time.
+   * @return std::chrono::nanoseconds Time after a write the ready-wait
+   * sleeps before polling again
+   */
+  std::chrono::nanoseconds cycleEstimate() const { return cycleEstimate_; }
+
+  /**
+   * @brief Get the call latency histograms.
+   *
+   * Safe to call from another thread; reads zero when built
+   * without DRIVER_FACADE_TELEMETRY. Status polls and ready-wait
+   * time are reported by readyStats().
+   *
+   * @return eeprom_telemetry Snapshot of the histograms
+   */
+  eeprom_telemetry telemetry() const;
+
+  /**
+   * @brief Reset the call latency histograms.
+   */
+  void resetTelemetry();
 
 private:
+  /**
+   * @brief Times one public call into its latency histogram.
+   *
+   * Public calls made by other public calls, like writeBit()
+   * going through updateBits(), count for the outermost one only.
+   */
+  class call_scope {
+  public:
+#if DRIVER_FACADE_TELEMETRY
+    call_scope(basic_eeprom_api &api, eeprom_call call);
+    ~call_scope();
+
+  private:
+    basic_eeprom_api &api_; ///< Instance being timed
+    eeprom_call call_;      ///< Histogram to record into
+    bool outer_;            ///< Not nested in another public call
+    std::chrono::steady_clock::time_point begin_; ///< Call entry time
+#else
+    call_scope(basic_eeprom_api &, eeprom_call) {}
+#endif
+  };
+
   /*
    * eeprom primitives
    * */
@@ -185,20 +591,84 @@ private:
   void waitUntilReady();
 
   /**
-   * @brief Send a raw command byte to EEPROM.
-   * @param command Command to send
+   * @brief Wait for the write cycle left pending by deferred mode.
    */
-  void sendCommand(uint8_t command);
+  void ensureReady();
 
   /**
-   * @brief Send a 9-bit EEPROM memory address over SPI.
+   * @brief Encode a command and its address into a header.
+   * @param command Command opcode
    * @param address Memory address
+   * @param header Output buffer of at least HEADER_SIZE bytes
+   */
+  void buildHeader(uint8_t command, address_type address, uint8_t *header);
+
+  /**
+   * @brief Program up to one page with a single WRITE transaction.
+   * @param address Memory address of the first byte
+   * @param data Pointer to data buffer
+   * @param length Number of bytes, must not cross a page boundary
+   */
+  void writePage(address_type address, const uint8_t *data, std::size_t length);
+
+  /**
+   * @brief Update up to one page, honouring the skip-unchanged mode.
+   * @param address Memory address of the first byte
+   * @param data Pointer to data buffer
+   * @param length Number of bytes, must not cross a page boundary
+   */
+  void updatePage(address_type address, const uint8_t *data,
+                  std::size_t length);
+
+  /**
+   * @brief Program a page span whose current contents are known.
+   * @param address Memory address of the first byte
+   * @param current Bytes currently stored in the span
+   * @param data New bytes for the span
+   * @param length Number of bytes, must not cross a page boundary
    */
-  void sendAddress(uint16_t address);
+  void writeChanged(address_type address, const uint8_t *current,
+                    const uint8_t *data, std::size_t length);
+
+  /**
+   * @brief Position the sequential read stream at the given address.
+   *
+   * Reuses the open READ transaction when it already points there,
+   * otherwise closes it and issues a new READ command.
+   *
+   * @param address Memory address of the next byte to read
+   */
+  void beginSequentialRead(address_type address);
+
+  /**
+   * @brief Clock the next byte out of the open READ transaction.
+   * @return Byte at the current stream address
+   */
+  uint8_t readNext();
 
 private:
   i_chip_spi_api &spi_api_; ///< SPI interface reference
 
+  bool readOpen_ = false;      ///< READ transaction is still selected
+  address_type readNext_ = 0; ///< Address the open READ will return next
+
+  bool skipUnchanged_ = false;    ///< Compare pages before programming
+  eeprom_write_stats writeStats_; ///< Write cycle counters
+
+  bool deferredReady_ = false; ///< Writes return before tWC ends
+  bool writePending_ = false;  ///< A write cycle may still be running
+  std::chrono::steady_clock::time_point writeStart_; ///< Last write deselect
+  /// Learned time from deselect to WIP clear, first poll target
+  std::chrono::nanoseconds cycleEstimate_ = WRITE_CYCLE_TIME / 2;
+  eeprom_ready_stats readyStats_; ///< Ready-wait counters
+
+#if DRIVER_FACADE_TELEMETRY
+  /// Latency per public call, indexed by eeprom_call
+  std::array<telemetry_histogram, static_cast<std::size_t>(eeprom_call::count)>
+      latency_;
+  int callDepth_ = 0; ///< Public calls currently on the stack
+#endif
+
   /*
    * eeprom commands
    * */
@@ -206,5 +676,26 @@ private:
   static constexpr uint8_t CMD_WRITE = 0x02;
   static constexpr uint8_t CMD_WREN = 0x06;
   static constexpr uint8_t CMD_RDSR = 0x05;
-  static constexpr uint8_t CMD_WRSR = 0x05;
+  static constexpr uint8_t CMD_WRSR = 0x01;
+
+  /// Command + address bytes
+  static constexpr std::size_t HEADER_SIZE = Chip::headerSize;
+
+  /// First back-off step while polling WIP
+  static constexpr std::chrono::microseconds POLL_INTERVAL{10};
 };
+
+extern template class basic_eeprom_api<eeprom_25lc010a>;
+extern template class basic_eeprom_api<eeprom_25lc020a>;
+extern template class basic_eeprom_api<eeprom_25lc040a>;
+extern template class basic_eeprom_api<eeprom_25lc080c>;
+extern template class basic_eeprom_api<eeprom_25lc160c>;
+extern template class basic_eeprom_api<eeprom_25lc320a>;
+extern template class basic_eeprom_api<eeprom_25lc640a>;
+extern template class basic_eeprom_api<eeprom_25lc128>;
+extern template class basic_eeprom_api<eeprom_25lc256>;
+extern template class basic_eeprom_api<eeprom_25lc512>;
+extern template class basic_eeprom_api<eeprom_25lc1024>;
+
+/// Driver for the 25LC040A, the part this library started with
+using eeprom_api = basic_eeprom_api<eeprom_25lc040a>;
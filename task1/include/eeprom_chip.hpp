@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "spi_timing.hpp"
+
+/**
+ * @brief Compile-time description of a 25xx SPI EEPROM.
+ *
+ * Everything basic_eeprom_api needs to know about a part: memory
+ * and page size, how the address is encoded after the opcode,
+ * the write cycle time it polls against and the fastest clock it
+ * accepts. All members are constants, so page splitting, address
+ * wrapping and header encoding fold into the specialized driver.
+ *
+ * @tparam Capacity Memory size in bytes, a power of two
+ * @tparam PageSize Write page size in bytes, a power of two
+ * @tparam AddressBytes Address bytes after the opcode, 1 to 3
+ * @tparam A8InOpcode Address bit 8 travels in bit 3 of the opcode
+ * @tparam WriteCycleUs Datasheet maximum of tWC in microseconds
+ * @tparam MaxSckHz Maximum SCK frequency in Hz over the whole supply
+ * range, i.e. the figure for the lowest rated supply voltage
+ */
+template <std::size_t Capacity, std::size_t PageSize, unsigned AddressBytes,
+          bool A8InOpcode, unsigned WriteCycleUs, uint32_t MaxSckHz>
+struct eeprom_chip {
+  /// Narrowest address type covering the memory
+  using address_type =
+      std::conditional_t<(Capacity > 0x10000), uint32_t, uint16_t>;
+
+  static constexpr std::size_t capacity = Capacity;      ///< Memory, bytes
+  static constexpr std::size_t pageSize = PageSize;      ///< Page, bytes
+  static constexpr unsigned addressBytes = AddressBytes; ///< After opcode
+  static constexpr bool a8InOpcode = A8InOpcode;         ///< A8 in opcode
+  /// Opcode plus address bytes
+  static constexpr std::size_t headerSize = 1 + AddressBytes;
+
+  /// Datasheet maximum of the internal write cycle (tWC)
+  static constexpr std::chrono::microseconds writeCycle{WriteCycleUs};
+
+  static constexpr uint32_t maxSckHz = MaxSckHz; ///< Maximum SCK, Hz
+
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+  static_assert((PageSize & (PageSize - 1)) == 0 && PageSize <= Capacity,
+                "page size must be a power of two within the capacity");
+  static_assert(AddressBytes >= 1 && AddressBytes <= 3,
+                "1 to 3 address bytes");
+  static_assert(Capacity <= (std::size_t{1} << (8 * AddressBytes +
+                                                (A8InOpcode ? 1 : 0))),
+                "capacity does not fit the address encoding");
+
+  /**
+   * @brief Encode a command and its address into a header.
+   * @param command Command opcode
+   * @param address Memory address, below capacity
+   * @param header Output buffer of headerSize bytes
+   */
+  static constexpr void encodeHeader(uint8_t command, address_type address,
+                                     uint8_t *header) {
+    header[0] = command;
+    if constexpr (A8InOpcode)
+      header[0] |= ((address >> 8) & 0x01) << 3;
+    for (unsigned i = 0; i < AddressBytes; ++i)
+      header[1 + i] = (address >> (8 * (AddressBytes - 1 - i))) & 0xFF;
+  }
+
+  /**
+   * @brief Get the fastest bus timing the part accepts.
+   * @param delayMode How to spend each half period
+   * @return spi_timing Timing at maxSckHz
+   */
+  static spi_timing timing(
+      spi_timing::mode delayMode = spi_timing::mode::busy_wait) {
+    return spi_timing(delayMode, MaxSckHz);
+  }
+};
+
+/*
+ * Microchip 25LC family, figures from the datasheets;
+ * SCK is the 2.5 V rating, the parts run twice as fast
+ * at 4.5-5.5 V
+ * */
+using eeprom_25lc010a = eeprom_chip<128, 16, 1, false, 5000, 5'000'000>;
+using eeprom_25lc020a = eeprom_chip<256, 16, 1, false, 5000, 5'000'000>;
+using eeprom_25lc040a = eeprom_chip<512, 16, 1, true, 5000, 5'000'000>;
+using eeprom_25lc080c = eeprom_chip<1024, 16, 2, false, 5000, 5'000'000>;
+using eeprom_25lc160c = eeprom_chip<2048, 16, 2, false, 5000, 5'000'000>;
+using eeprom_25lc320a = eeprom_chip<4096, 32, 2, false, 5000, 5'000'000>;
+using eeprom_25lc640a = eeprom_chip<8192, 32, 2, false, 5000, 5'000'000>;
+using eeprom_25lc128 = eeprom_chip<16384, 64, 2, false, 5000, 5'000'000>;
+using eeprom_25lc256 = eeprom_chip<32768, 64, 2, false, 5000, 5'000'000>;
+using eeprom_25lc512 = eeprom_chip<65536, 128, 2, false, 5000, 10'000'000>;
+using eeprom_25lc1024 = eeprom_chip<131072, 256, 3, false, 6000, 10'000'000>;
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "spi_device_model.hpp"
+
+/**
+ * @brief Geometry, timing and wiring of a simulated 25xx EEPROM.
+ *
+ * Defaults describe a 25LC040A: 512 bytes, 16-byte pages,
+ * one address byte with A8 carried in bit 3 of the opcode.
+ */
+struct eeprom_model_config {
+  std::size_t capacity = 512; ///< Memory size in bytes
+  std::size_t pageSize = 16;  ///< Write page size in bytes
+  int addressBytes = 1;       ///< Address bytes after the opcode
+  bool a8InOpcode = true;     ///< Address bit 8 sent as opcode bit 3
+  std::chrono::microseconds writeCycle{5000}; ///< Emulated tWC
+  bool portAccess = true;     ///< Advertise setMask/writePort
+  spi_model_pins pins;        ///< Wiring
+
+  /**
+   * @brief Describe the part an eeprom_chip descriptor stands for.
+   * @tparam Chip eeprom_chip instantiation
+   * @return eeprom_model_config Geometry, encoding and tWC of the part
+   */
+  template <class Chip> static eeprom_model_config forChip() {
+    eeprom_model_config config;
+    config.capacity = Chip::capacity;
+    config.pageSize = Chip::pageSize;
+    config.addressBytes = Chip::addressBytes;
+    config.a8InOpcode = Chip::a8InOpcode;
+    config.writeCycle = Chip::writeCycle;
+    return config;
+  }
+};
+
+/**
+ * @brief Software model of a 25xx SPI EEPROM behind i_chip_gpio_driver.
+ *
+ * Keeps a real memory array behind the spi_device_model pin
+ * front end: READ with sequential roll-over, WRITE with page
+ * wraparound, WREN/WRDI, RDSR and WRSR with block protection,
+ * WEL/WIP semantics and an emulated write cycle. Commands other
+ * than RDSR are ignored while a write cycle is in progress, the
+ * same as on the chip.
+ */
+class eeprom_model final : public spi_device_model {
+public:
+  /**
+   * @brief Construct a model filled with 0xFF, the erased state.
+   * @param config Geometry, timing and wiring
+   */
+  explicit eeprom_model(eeprom_model_config config = eeprom_model_config());
+
+  /**
+   * @brief Direct access to the memory array, bypassing the bus.
+   * @return std::vector<uint8_t>& Memory contents
+   */
+  std::vector<uint8_t> &memory() { return memory_; }
+
+  /**
+   * @brief Get the status register as RDSR would return it.
+   * @return uint8_t Status register value
+   */
+  uint8_t status();
+
+  /**
+   * @brief Tell whether a write cycle is in progress.
+   * @return true while WIP is set
+   */
+  bool busy();
+
+  /**
+   * @brief Get the number of internal write cycles started.
+   * @return uint64_t Write cycles since the last reset
+   */
+  uint64_t writeCycles() const { return writeCycles_; }
+
+  /**
+   * @brief Reset the pin and write cycle counters.
+   */
+  void resetCounters() override;
+
+  /*
+   * status register bits
+   * */
+  static constexpr uint8_t STATUS_WIP = 0x01; ///< Write in progress
+  static constexpr uint8_t STATUS_WEL = 0x02; ///< Write enable latch
+  static constexpr uint8_t STATUS_BP = 0x0C;  ///< Block protect bits
+
+private:
+  /**
+   * @brief Command decoder state within one CS window.
+   */
+  enum class phase {
+    command, ///< Waiting for the opcode
+    address, ///< Collecting address bytes
+    read,    ///< Streaming memory out
+    write,   ///< Collecting page data
+    status,  ///< Streaming the status register out
+    wrsr,    ///< Waiting for the new status value
+    ignore,  ///< Nothing more to decode until CS rises
+  };
+
+  void onSelect() override;
+  void onByte(uint8_t byte) override;
+  void onDeselect(bool aligned) override;
+  uint8_t nextOutput() override;
+
+  /**
+   * @brief Start an internal write cycle.
+   */
+  void startWriteCycle();
+
+  /**
+   * @brief Retire a finished write cycle.
+   */
+  void updateBusy();
+
+  /**
+   * @brief Tell whether block protection covers an address.
+   * @param address Memory address
+   * @return true if writes to the address are inhibited
+   */
+  bool isProtected(std::size_t address) const;
+
+  /**
+   * @brief Tell whether any latched byte falls into a protected block.
+   * @return true if the page write must not start
+   */
+  bool pageProtected() const;
+
+private:
+  eeprom_model_config config_;  ///< Geometry, timing and wiring
+  std::vector<uint8_t> memory_; ///< Memory array
+
+  phase phase_ = phase::ignore;     ///< Decoder state
+  uint8_t opcode_ = 0;              ///< Current opcode
+  int addressLeft_ = 0;             ///< Address bytes still expected
+  std::size_t address_ = 0;         ///< Address pointer
+  std::vector<uint8_t> pageBuffer_; ///< Latched write data
+  std::size_t pageBase_ = 0;        ///< Page the write targets
+  std::vector<bool> pageLatched_;   ///< Page buffer bytes received
+  uint8_t newStatus_ = 0;           ///< Value received by WRSR
+  bool wrsrReceived_ = false;       ///< WRSR got its data byte
+
+  bool wel_ = false;         ///< Write enable latch
+  uint8_t blockProtect_ = 0; ///< BP1:BP0 bits in status position
+  std::chrono::steady_clock::time_point busyUntil_; ///< End of write cycle
+  bool writing_ = false;     ///< A write cycle was started
+
+  uint64_t writeCycles_ = 0; ///< Internal write cycles started
+
+  /*
+   * eeprom commands, READ and WRITE carry A8 in bit 3
+   * */
+  static constexpr uint8_t CMD_READ = 0x03;
+  static constexpr uint8_t CMD_WRITE = 0x02;
+  static constexpr uint8_t CMD_WRDI = 0x04;
+  static constexpr uint8_t CMD_WREN = 0x06;
+  static constexpr uint8_t CMD_RDSR = 0x05;
+  static constexpr uint8_t CMD_WRSR = 0x01;
+};
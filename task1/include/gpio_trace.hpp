@@ -0,0 +1,238 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief What a trace event records.
+ */
+enum class gpio_trace_kind : uint8_t {
+  write, ///< The master drove the masked pins
+  read,  ///< The master sampled the masked pins
+  gap,   ///< Events were dropped here, levels holds how many
+};
+
+/**
+ * @brief One timestamped pin operation.
+ *
+ * Only pins 0..31 can be traced; operations on other pins are
+ * forwarded but not recorded.
+ */
+struct gpio_trace_event {
+  uint64_t time;        ///< Nanoseconds since the tracer was created
+  uint32_t mask;        ///< Pins written or read, bit n for pin n
+  uint32_t levels;      ///< Levels of the masked pins, or the gap size
+  gpio_trace_kind kind; ///< Write or read
+};
+
+/**
+ * @brief Preallocated single-producer single-consumer event ring.
+ *
+ * The traced bus pushes from its own thread without locks or
+ * allocation; another thread drains the ring, for example into a
+ * trace file. When the ring is full new events are dropped and
+ * counted, so the bus is never slowed down by a slow consumer.
+ * The next event that fits is preceded by a gap event carrying
+ * the number of events lost, so readers of the trace know where
+ * it has holes.
+ */
+class gpio_trace_ring {
+public:
+  /**
+   * @brief Construct the ring.
+   * @param capacity Minimum number of events, rounded up to a
+   * power of two
+   */
+  explicit gpio_trace_ring(std::size_t capacity);
+
+  /**
+   * @brief Append an event, producer side.
+   *
+   * After a drop the event needs a second slot for the gap event
+   * in front of it.
+   *
+   * @param event Event to record
+   * @return true if stored, false if the ring was full
+   */
+  bool push(const gpio_trace_event &event) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    std::size_t slots = lost_ ? 2 : 1;
+    if (head - tail_.load(std::memory_order_acquire) + slots > mask_ + 1) {
+      if (lost_ != std::numeric_limits<uint32_t>::max())
+        ++lost_;
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (lost_) {
+      events_[head++ & mask_] = {event.time, 0, lost_, gpio_trace_kind::gap};
+      lost_ = 0;
+    }
+    events_[head & mask_] = event;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Take the oldest events, consumer side.
+   * @param out Buffer for the events
+   * @param max Buffer size in events
+   * @return std::size_t Number of events taken
+   */
+  std::size_t pop(gpio_trace_event *out, std::size_t max);
+
+  /**
+   * @brief Append every pending event to a vector, consumer side.
+   * @param out Destination
+   * @return std::size_t Number of events taken
+   */
+  std::size_t drain(std::vector<gpio_trace_event> &out);
+
+  /**
+   * @brief Get the number of events the ring holds at most.
+   * @return std::size_t Capacity in events
+   */
+  std::size_t capacity() const { return mask_ + 1; }
+
+  /**
+   * @brief Get the number of events lost to a full ring.
+   * @return uint64_t Dropped events since construction
+   */
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  std::size_t mask_;                           ///< Capacity minus one
+  std::unique_ptr<gpio_trace_event[]> events_; ///< Event storage
+  uint32_t lost_ = 0; ///< Drops not marked by a gap event yet, producer side
+
+  alignas(64) std::atomic<std::size_t> head_{0}; ///< Next slot to fill
+  alignas(64) std::atomic<std::size_t> tail_{0}; ///< Next slot to take
+  alignas(64) std::atomic<uint64_t> dropped_{0}; ///< Events lost
+};
+
+/**
+ * @brief GPIO driver decorator recording every pin operation.
+ *
+ * Wraps any i_chip_gpio_driver and pushes one timestamped event
+ * per write or read into a gpio_trace_ring, after forwarding the
+ * operation. Port writes stay single events, so a traced bus
+ * costs one clock read and one ring slot per GPIO access. Edge
+ * lists from submit() are played edge by edge through the
+ * decorator so that every edge gets its own timestamp.
+ */
+class tracing_gpio_driver final : public i_chip_gpio_driver {
+public:
+  /**
+   * @brief Construct the decorator.
+   * @param inner Driver doing the pin operations
+   * @param ring Ring receiving the events
+   */
+  tracing_gpio_driver(i_chip_gpio_driver &inner, gpio_trace_ring &ring);
+
+  void setHigh(int pin) override;
+  void setLow(int pin) override;
+  bool read(int pin) override;
+
+  bool hasPortAccess() const override { return inner_.hasPortAccess(); }
+  void setMask(uint32_t mask) override;
+  void clearMask(uint32_t mask) override;
+  void writePort(uint32_t mask, uint32_t values) override;
+  uint32_t readMask(uint32_t mask) override;
+  void setDirection(int pin, bool output) override;
+
+private:
+  /**
+   * @brief Push an event stamped with the current time.
+   * @param kind Write or read
+   * @param mask Pins involved
+   * @param levels Levels of the masked pins
+   */
+  void record(gpio_trace_kind kind, uint32_t mask, uint32_t levels);
+
+private:
+  i_chip_gpio_driver &inner_; ///< Driver doing the pin operations
+  gpio_trace_ring &ring_;     ///< Event destination
+
+  std::chrono::steady_clock::time_point start_; ///< Time zero of the trace
+};
+
+/**
+ * @brief Start a binary trace file.
+ *
+ * The file starts with a magic string and holds the events in a
+ * fixed little-endian layout, so traces move between hosts.
+ *
+ * @param out Binary output stream
+ */
+void writeTraceHeader(std::ostream &out);
+
+/**
+ * @brief Append events to a binary trace file.
+ * @param out Stream positioned after the header
+ * @param events Events to write
+ * @param count Number of events
+ */
+void writeTraceEvents(std::ostream &out, const gpio_trace_event *events,
+                      std::size_t count);
+
+/**
+ * @brief Read a binary trace file.
+ * @param in Binary input stream
+ * @param events Destination for the events
+ * @return true if the file is a trace, false if the magic is wrong
+ */
+bool readTrace(std::istream &in, std::vector<gpio_trace_event> &events);
+
+/**
+ * @brief Pins to export to VCD with their signal names.
+ */
+using gpio_pin_names = std::vector<std::pair<int, std::string>>;
+
+/**
+ * @brief Export a trace as a Value Change Dump.
+ *
+ * One wire per named pin, time in nanoseconds; a pin shows up
+ * from the first event that involves it. Gaps become comments.
+ *
+ * @param out Text output stream
+ * @param events Events in time order
+ * @param names Pins to export and their signal names
+ */
+void writeVcd(std::ostream &out, const std::vector<gpio_trace_event> &events,
+              const gpio_pin_names &names);
+
+/**
+ * @brief One SPI transaction decoded from a trace.
+ */
+struct spi_trace_transaction {
+  uint64_t start = 0;        ///< CS falling edge, ns
+  uint64_t end = 0;          ///< CS rising edge, ns
+  std::vector<uint8_t> mosi; ///< Bytes sent by the master
+  std::vector<uint8_t> miso; ///< Bytes the master sampled
+  unsigned trailingBits = 0; ///< Bits clocked after the last whole byte
+  bool gap = false;          ///< Events were dropped inside, bytes unreliable
+};
+
+/**
+ * @brief Decode SPI mode 0 transactions from a trace.
+ *
+ * MOSI is taken on each SCK rising edge; the MISO bit is the
+ * last level the master read before SCK fell again. Transactions
+ * overlapping a gap in the trace are flagged; one whose start
+ * fell into a gap is not reported at all.
+ *
+ * @param events Events in time order
+ * @param pins Bus wiring, data lines 0 and 1 only
+ * @return std::vector<spi_trace_transaction> Complete transactions
+ */
+std::vector<spi_trace_transaction>
+decodeSpi(const std::vector<gpio_trace_event> &events, spi_pin_map pins);
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief Program and erase counters of a nor_flash_api instance.
+ */
+struct nor_flash_stats {
+  uint64_t pagePrograms = 0;    ///< Page Program commands issued
+  uint64_t bytesProgrammed = 0; ///< Payload bytes clocked into programs
+  uint64_t erases = 0;          ///< Erase commands issued, any size
+  uint64_t inPlaceCommits = 0;  ///< Sector commits that needed no erase
+};
+
+/**
+ * @brief Read commands of a serial NOR flash, narrowest first.
+ */
+enum class nor_read_mode {
+  standard, ///< READ (0x03), one data line
+  fast,     ///< Fast Read (0x0B), one data line and 8 dummy clocks
+  dual,     ///< Dual Output (0x3B), two data lines
+  quad,     ///< Quad Output (0x6B), four data lines, needs QE
+};
+
+/**
+ * @brief Serial NOR flash (W25Q128) implementation of the memory API.
+ *
+ * Addresses are 24 bits wide. Next to the raw page program,
+ * erase and status commands, the byte-oriented API goes through
+ * a one-sector write-back buffer: writes land in RAM and are
+ * committed when another sector is touched, on flush() or on
+ * destruction. A commit erases the sector only if some bit has
+ * to go from 0 to 1; otherwise it programs just the bytes that
+ * changed, in place.
+ *
+ * Reads use the widest output mode both the bus and the chip
+ * support, see selectReadMode().
+ */
+class nor_flash_api final : public basic_memory_device_api<uint32_t> {
+public:
+  /**
+   * @brief Construct NOR flash API with SPI interface.
+   * @param spi SPI interface reference
+   * @param capacity Device size in bytes
+   */
+  explicit nor_flash_api(i_chip_spi_api &spi, uint32_t capacity = CAPACITY);
+
+  /**
+   * @brief Commit the buffered sector and wait for the chip.
+   */
+  ~nor_flash_api() override;
+
+  void writeByte(uint32_t address, uint8_t data) override;
+  uint8_t readByte(uint32_t address) override;
+
+  void writeBuffer(uint32_t address, const uint8_t *data,
+                   std::size_t length) override;
+  void readBuffer(uint32_t address, uint8_t *buffer,
+                  std::size_t length) override;
+
+  void writeBit(uint32_t address, uint8_t bitPosition, bool value) override;
+  bool readBit(uint32_t address, uint8_t bitPosition) override;
+
+  /**
+   * @brief Commit the buffered sector to the chip.
+   */
+  void flush();
+
+  /**
+   * @brief Program up to one page with a single Page Program command.
+   *
+   * Bypasses the write buffer, which is committed first.
+   * Programming only clears bits; the target must be erased.
+   * Bytes past the end of the page are not programmed.
+   *
+   * @param address Address of the first byte
+   * @param data Pointer to data buffer
+   * @param length Number of bytes
+   * @return std::size_t Bytes programmed, at most up to the page end
+   */
+  std::size_t programPage(uint32_t address, const uint8_t *data,
+                          std::size_t length);
+
+  /**
+   * @brief Erase the 4 KB sector holding an address.
+   * @param address Any address inside the sector
+   */
+  void eraseSector(uint32_t address);
+
+  /**
+   * @brief Erase the 32 KB block holding an address.
+   * @param address Any address inside the block
+   */
+  void eraseBlock32(uint32_t address);
+
+  /**
+   * @brief Erase the 64 KB block holding an address.
+   * @param address Any address inside the block
+   */
+  void eraseBlock64(uint32_t address);
+
+  /**
+   * @brief Read the JEDEC manufacturer and device ID.
+   * @return uint32_t ID as 0x00MMTTCC
+   */
+  uint32_t readJedecId();
+
+  /**
+   * @brief Read status register 1.
+   * @return uint8_t Status register value
+   */
+  uint8_t readStatus();
+
+  /**
+   * @brief Read status register 2.
+   * @return uint8_t Status register value
+   */
+  uint8_t readStatus2();
+
+  /**
+   * @brief Poll BUSY until the current program or erase finishes.
+   */
+  void waitUntilReady();
+
+  /**
+   * @brief Pick the widest read mode the bus and the chip support.
+   *
+   * Quad needs four bus lines and the QE bit, which is read from
+   * status register 2; dual only needs two lines. Single-line
+   * buses use the plain READ, which has no dummy clocks.
+   *
+   * @return nor_read_mode Selected mode
+   */
+  nor_read_mode selectReadMode();
+
+  /**
+   * @brief Set the QE bit so the chip accepts Quad Output reads.
+   *
+   * QE is non-volatile, so this is a one-time provisioning step.
+   * Selects the read mode again afterwards.
+   */
+  void enableQuad();
+
+  /**
+   * @brief Force a read mode.
+   * @param mode Read command to use, must be supported by bus and chip
+   */
+  void setReadMode(nor_read_mode mode) { readMode_ = mode; }
+
+  /**
+   * @brief Get the read mode in use.
+   * @return nor_read_mode Current mode
+   */
+  nor_read_mode readMode() const { return readMode_; }
+
+  /**
+   * @brief Get the program and erase counters.
+   * @return const nor_flash_stats& Counters since the last reset
+   */
+  const nor_flash_stats &stats() const { return stats_; }
+
+  /**
+   * @brief Reset the program and erase counters.
+   */
+  void resetStats() { stats_ = {}; }
+
+  /*
+   * device geometry
+   * */
+  static constexpr uint32_t CAPACITY = 16 * 1024 * 1024; ///< W25Q128, bytes
+  static constexpr std::size_t PAGE_SIZE = 256;          ///< Program page
+  static constexpr std::size_t SECTOR_SIZE = 4 * 1024;   ///< Smallest erase
+  static constexpr std::size_t BLOCK32_SIZE = 32 * 1024; ///< 32 KB block
+  static constexpr std::size_t BLOCK64_SIZE = 64 * 1024; ///< 64 KB block
+
+private:
+  /**
+   * @brief Set the write enable latch.
+   */
+  void writeEnable();
+
+  /**
+   * @brief Encode a command and its 24-bit address into a header.
+   * @param command Command opcode
+   * @param address Memory address
+   * @param header Output buffer of at least HEADER_SIZE bytes
+   */
+  void buildHeader(uint8_t command, uint32_t address, uint8_t *header);
+
+  /**
+   * @brief Read a range straight from the chip in the current mode.
+   * @param address Starting memory address
+   * @param buffer Pointer to buffer to store data
+   * @param length Number of bytes to read
+   */
+  void readRaw(uint32_t address, uint8_t *buffer, std::size_t length);
+
+  /**
+   * @brief Issue Page Program and wait for it to finish.
+   * @param address Address of the first byte
+   * @param data Pointer to data buffer
+   * @param length Number of bytes, must not cross a page boundary
+   */
+  void program(uint32_t address, const uint8_t *data, std::size_t length);
+
+  /**
+   * @brief Issue an erase command and wait for it to finish.
+   * @param command Erase opcode
+   * @param address Any address inside the block
+   */
+  void erase(uint8_t command, uint32_t address);
+
+  /**
+   * @brief Make a sector the buffered one, committing the previous.
+   * @param base Sector base address
+   */
+  void loadSector(uint32_t base);
+
+  /**
+   * @brief Program a sector image, erasing first only if needed.
+   */
+  void commitSector();
+
+private:
+  i_chip_spi_api &spi_api_; ///< SPI interface reference
+  uint32_t capacity_;       ///< Device size in bytes
+
+  std::vector<uint8_t> original_; ///< Buffered sector as on the chip
+  std::vector<uint8_t> image_;    ///< Buffered sector with pending writes
+  uint32_t sectorBase_ = 0;       ///< Address of the buffered sector
+  bool sectorLoaded_ = false;     ///< A sector is buffered
+  bool sectorDirty_ = false;      ///< image_ differs from original_
+
+  nor_flash_stats stats_; ///< Program and erase counters
+  nor_read_mode readMode_ = nor_read_mode::standard; ///< Read command
+
+  /*
+   * flash commands
+   * */
+  static constexpr uint8_t CMD_READ = 0x03;
+  static constexpr uint8_t CMD_FAST_READ = 0x0B;
+  static constexpr uint8_t CMD_DUAL_READ = 0x3B;
+  static constexpr uint8_t CMD_QUAD_READ = 0x6B;
+  static constexpr uint8_t CMD_PP = 0x02;
+  static constexpr uint8_t CMD_WREN = 0x06;
+  static constexpr uint8_t CMD_RDSR = 0x05;
+  static constexpr uint8_t CMD_RDSR2 = 0x35;
+  static constexpr uint8_t CMD_WRSR2 = 0x31;
+  static constexpr uint8_t CMD_SE = 0x20;
+  static constexpr uint8_t CMD_BE32 = 0x52;
+  static constexpr uint8_t CMD_BE64 = 0xD8;
+  static constexpr uint8_t CMD_JEDEC_ID = 0x9F;
+
+  static constexpr uint8_t STATUS_BUSY = 0x01; ///< Program/erase running
+  static constexpr uint8_t STATUS2_QE = 0x02;  ///< Quad enable
+
+  /// Dummy clocks between address and data of the fast reads
+  static constexpr unsigned FAST_READ_DUMMY_CYCLES = 8;
+
+  static constexpr std::size_t HEADER_SIZE = 4; ///< Command + 24-bit address
+
+  /// First back-off step while polling BUSY
+  static constexpr std::chrono::microseconds POLL_INTERVAL{10};
+  /// Longest back-off step, well below a sector erase
+  static constexpr std::chrono::microseconds MAX_POLL_INTERVAL{1000};
+};
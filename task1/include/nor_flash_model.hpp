@@ -0,0 +1,182 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "spi_device_model.hpp"
+
+/**
+ * @brief Geometry, timing and wiring of a simulated serial NOR flash.
+ *
+ * Defaults describe a W25Q128 with typical datasheet timings.
+ */
+struct nor_flash_model_config {
+  std::size_t capacity = 16 * 1024 * 1024; ///< Memory size in bytes
+  std::chrono::microseconds pageProgram{700};     ///< Emulated tPP
+  std::chrono::microseconds sectorErase{45000};   ///< Emulated tSE
+  std::chrono::microseconds block32Erase{120000}; ///< Emulated tBE1
+  std::chrono::microseconds block64Erase{150000}; ///< Emulated tBE2
+  std::chrono::microseconds statusWrite{10000};   ///< Emulated tW
+  bool quadEnable = false; ///< Initial QE bit in status register 2
+  bool portAccess = true; ///< Advertise setMask/writePort
+  spi_model_pins pins;    ///< Wiring
+};
+
+/**
+ * @brief Software model of a W25Q-style serial NOR flash.
+ *
+ * Implements READ, Fast Read and the Dual (0x3B) and Quad (0x6B)
+ * Output reads, Page Program with wraparound inside the 256-byte
+ * page, 4K/32K/64K erase, WREN/WRDI, both status registers with
+ * the QE bit and the JEDEC ID. Quad Output needs QE set.
+ * Programming can only clear bits, erasing sets a whole block
+ * to 0xFF, and every command other than RDSR is ignored while
+ * BUSY is set, the same as on the chip.
+ */
+class nor_flash_model final : public spi_device_model {
+public:
+  /**
+   * @brief Construct a model filled with 0xFF, the erased state.
+   * @param config Geometry, timing and wiring
+   */
+  explicit nor_flash_model(
+      nor_flash_model_config config = nor_flash_model_config());
+
+  /**
+   * @brief Direct access to the memory array, bypassing the bus.
+   * @return std::vector<uint8_t>& Memory contents
+   */
+  std::vector<uint8_t> &memory() { return memory_; }
+
+  /**
+   * @brief Get status register 1 as RDSR would return it.
+   * @return uint8_t Status register value
+   */
+  uint8_t status();
+
+  /**
+   * @brief Get status register 2 as RDSR-2 would return it.
+   * @return uint8_t Status register value
+   */
+  uint8_t status2() const { return status2_; }
+
+  /**
+   * @brief Tell whether a program or erase is in progress.
+   * @return true while BUSY is set
+   */
+  bool busy();
+
+  /**
+   * @brief Get the number of page programs started.
+   * @return uint64_t Page programs since the last reset
+   */
+  uint64_t pagePrograms() const { return pagePrograms_; }
+
+  /**
+   * @brief Get the number of erases started, of any size.
+   * @return uint64_t Erases since the last reset
+   */
+  uint64_t erases() const { return erases_; }
+
+  /**
+   * @brief Reset the pin, program and erase counters.
+   */
+  void resetCounters() override;
+
+  /*
+   * status register 1 bits
+   * */
+  static constexpr uint8_t STATUS_BUSY = 0x01; ///< Program/erase running
+  static constexpr uint8_t STATUS_WEL = 0x02;  ///< Write enable latch
+  static constexpr uint8_t STATUS2_QE = 0x02;  ///< Quad enable
+
+  static constexpr std::size_t PAGE_SIZE = 256; ///< Program page, bytes
+
+private:
+  /**
+   * @brief Command decoder state within one CS window.
+   */
+  enum class phase {
+    command, ///< Waiting for the opcode
+    address, ///< Collecting the 24-bit address
+    dummy,   ///< Waiting out the 8 dummy clocks of a fast read
+    read,    ///< Streaming memory out
+    program, ///< Collecting page data
+    output,  ///< Streaming a register out
+    status,  ///< Collecting new status register values
+    ignore,  ///< Nothing more to decode until CS rises
+  };
+
+  void onSelect() override;
+  void onByte(uint8_t byte) override;
+  void onDeselect(bool aligned) override;
+  uint8_t nextOutput() override;
+
+  /**
+   * @brief Erase the block holding the current address.
+   * @param size Block size in bytes
+   * @param duration Emulated erase time
+   */
+  void erase(std::size_t size, std::chrono::microseconds duration);
+
+  /**
+   * @brief Set BUSY for an emulated operation time.
+   * @param duration Operation time
+   */
+  void startBusy(std::chrono::microseconds duration);
+
+  /**
+   * @brief Retire a finished program or erase.
+   */
+  void updateBusy();
+
+private:
+  nor_flash_model_config config_; ///< Geometry, timing and wiring
+  std::vector<uint8_t> memory_;   ///< Memory array
+
+  phase phase_ = phase::ignore;     ///< Decoder state
+  uint8_t opcode_ = 0;              ///< Current opcode
+  int addressLeft_ = 0;             ///< Address bytes still expected
+  std::size_t address_ = 0;         ///< Address pointer
+  std::vector<uint8_t> pageBuffer_; ///< Latched program data
+  std::size_t pageBase_ = 0;        ///< Page the program targets
+  std::vector<bool> pageLatched_;   ///< Page buffer bytes received
+  unsigned readWidth_ = 1;          ///< Data lines of the current read
+  uint8_t newStatus_[2] = {};       ///< Values received by a status write
+  int statusReceived_ = 0;          ///< Status bytes received
+  const uint8_t *output_ = nullptr; ///< Register bytes being streamed
+  std::size_t outputLength_ = 0;    ///< Length of the register
+  std::size_t outputIndex_ = 0;     ///< Next register byte
+
+  bool wel_ = false;   ///< Write enable latch
+  uint8_t status2_ = 0; ///< Status register 2
+  std::chrono::steady_clock::time_point busyUntil_; ///< End of operation
+  bool busy_ = false; ///< A program or erase was started
+
+  uint64_t pagePrograms_ = 0; ///< Page programs started
+  uint64_t erases_ = 0;       ///< Erases started
+
+  /*
+   * flash commands
+   * */
+  static constexpr uint8_t CMD_WREN = 0x06;
+  static constexpr uint8_t CMD_WRDI = 0x04;
+  static constexpr uint8_t CMD_RDSR = 0x05;
+  static constexpr uint8_t CMD_RDSR2 = 0x35;
+  static constexpr uint8_t CMD_WRSR = 0x01;
+  static constexpr uint8_t CMD_WRSR2 = 0x31;
+  static constexpr uint8_t CMD_READ = 0x03;
+  static constexpr uint8_t CMD_FAST_READ = 0x0B;
+  static constexpr uint8_t CMD_DUAL_READ = 0x3B;
+  static constexpr uint8_t CMD_QUAD_READ = 0x6B;
+  static constexpr uint8_t CMD_PP = 0x02;
+  static constexpr uint8_t CMD_SE = 0x20;
+  static constexpr uint8_t CMD_BE32 = 0x52;
+  static constexpr uint8_t CMD_BE64 = 0xD8;
+  static constexpr uint8_t CMD_JEDEC_ID = 0x9F;
+
+  /// Manufacturer, memory type and capacity of a W25Q128
+  static constexpr uint8_t JEDEC_ID[3] = {0xEF, 0x40, 0x18};
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief Counters of a record_store instance.
+ */
+struct record_store_stats {
+  uint64_t appends = 0;     ///< Records written by put() and erase()
+  uint64_t relocations = 0; ///< Live records moved by compaction
+  uint64_t reclaimed = 0;   ///< Pages freed by compaction
+  uint64_t unchanged = 0;   ///< put() calls that matched the stored value
+};
+
+/**
+ * @brief Log-structured key/value store on a memory device.
+ *
+ * Every record takes one page: a 5-byte header (key, length and
+ * tombstone flag, 16-bit sequence number, CRC-8) followed by the
+ * value. Updates never rewrite a record in place, they append a
+ * new one at the head of a circular log, so the write cycles go
+ * round the whole device instead of hammering one page, and a
+ * torn write leaves the previous version intact.
+ *
+ * mount() reads the device once with a sequential read into a
+ * RAM image and indexes the newest record per key; from then on
+ * lookups are served from RAM. Compaction walks the tail of the
+ * log, copying the records that are still live to the head, one
+ * page per compactStep(); put() only compacts when it runs out of
+ * free pages, so calling compactStep() from an idle loop keeps
+ * the write path short.
+ */
+class record_store {
+public:
+  static constexpr std::size_t HEADER_SIZE = 5; ///< Record header, bytes
+  static constexpr uint8_t NO_KEY = 0xFF;       ///< Key of an erased page
+
+  /**
+   * @brief Construct the store over a device and mount it.
+   * @param device Backing device
+   * @param capacity Device size in bytes
+   * @param pageSize Device write page size in bytes, at most 132
+   * @throw std::invalid_argument if the page size is out of range,
+   * there are fewer than three pages or capacity exceeds 64 KB
+   */
+  explicit record_store(i_memory_device_api &device,
+                        std::size_t capacity = eeprom_api::MEMORY_SIZE,
+                        std::size_t pageSize = eeprom_api::PAGE_SIZE);
+
+  /**
+   * @brief Rebuild the index from the device contents.
+   */
+  void mount();
+
+  /**
+   * @brief Store a value under a key.
+   *
+   * Fails if the key is NO_KEY, the value does not fit a page,
+   * or a new key would leave compaction without room.
+   *
+   * @param key Record key, 0..254
+   * @param data Value bytes
+   * @param length Value length, at most maxValueSize()
+   * @return true if the value is stored
+   */
+  bool put(uint8_t key, const uint8_t *data, std::size_t length);
+
+  /**
+   * @brief Remove a key.
+   * @param key Record key
+   * @return true if the key existed
+   */
+  bool erase(uint8_t key);
+
+  /**
+   * @brief Tell whether a key holds a value.
+   * @param key Record key
+   * @return true if the key exists
+   */
+  bool contains(uint8_t key) const;
+
+  /**
+   * @brief Get the length of the value stored under a key.
+   * @param key Record key
+   * @return std::size_t Value length, 0 if the key does not exist
+   */
+  std::size_t length(uint8_t key) const;
+
+  /**
+   * @brief Copy the value stored under a key out of RAM.
+   * @param key Record key
+   * @param buffer Destination buffer
+   * @param size Buffer size
+   * @return std::size_t Bytes copied, 0 if the key does not exist
+   */
+  std::size_t read(uint8_t key, uint8_t *buffer, std::size_t size) const;
+
+  /**
+   * @brief Reclaim one page at the tail of the log.
+   *
+   * A dead record is dropped for free, a live one costs a page
+   * write to the head.
+   *
+   * @return true if a page was reclaimed, false if every used
+   * page still holds a live record
+   */
+  bool compactStep();
+
+  /**
+   * @brief Get the largest value a record can hold.
+   * @return std::size_t Page size minus the header
+   */
+  std::size_t maxValueSize() const { return pageSize_ - HEADER_SIZE; }
+
+  /**
+   * @brief Get the number of keys the store can hold.
+   *
+   * Two pages stay in reserve so that updates and compaction
+   * always find room.
+   *
+   * @return std::size_t Maximum number of live records
+   */
+  std::size_t maxRecords() const { return pages_ - 2; }
+
+  /**
+   * @brief Get the number of pages not holding any record.
+   * @return std::size_t Free page count
+   */
+  std::size_t freePages() const { return free_; }
+
+  /**
+   * @brief Get the store counters.
+   * @return const record_store_stats& Counters since construction
+   */
+  const record_store_stats &stats() const { return stats_; }
+
+private:
+  static constexpr int16_t NOWHERE = -1;       ///< Index of a missing key
+  static constexpr uint8_t TOMBSTONE = 0x80;   ///< Length byte flag
+  static constexpr uint8_t LENGTH_MASK = 0x7F; ///< Length byte value bits
+
+  /**
+   * @brief Tell whether a page holds a record with a valid CRC.
+   * @param page Page index
+   * @return true if the header and value check out
+   */
+  bool isRecord(std::size_t page) const;
+
+  /**
+   * @brief Get the key of a page, NO_KEY if it holds no record.
+   * @param page Page index
+   * @return uint8_t Record key
+   */
+  uint8_t keyOf(std::size_t page) const;
+
+  /**
+   * @brief Tell whether a page holds the record a key resolves to.
+   *
+   * Tombstones stay live while an older record of their key is
+   * still on the device, or that record would come back at the
+   * next mount.
+   *
+   * @param page Page index
+   * @return true if compaction has to keep the record
+   */
+  bool isLive(std::size_t page) const;
+
+  /**
+   * @brief Tell whether a page holds a tombstone.
+   * @param page Page index, holding a record
+   * @return true if the record marks its key as erased
+   */
+  bool isTombstone(std::size_t page) const {
+    return pageData(page)[1] & TOMBSTONE;
+  }
+
+  /**
+   * @brief Count the pages compaction has to keep.
+   * @return std::size_t Live record count
+   */
+  std::size_t livePages() const;
+
+  /**
+   * @brief Write a record at the head of the log.
+   * @param key Record key
+   * @param flags Length byte flags, TOMBSTONE or 0
+   * @param data Value bytes
+   * @param length Value length
+   * @return std::size_t Page the record went to
+   */
+  std::size_t append(uint8_t key, uint8_t flags, const uint8_t *data,
+                     std::size_t length);
+
+  /**
+   * @brief Compact until at least two pages are free.
+   * @return true if the pages are available
+   */
+  bool reserve();
+
+  /**
+   * @brief Get a pointer to a page in the RAM image.
+   * @param page Page index
+   * @return uint8_t* First byte of the page
+   */
+  uint8_t *pageData(std::size_t page) { return &image_[page * pageSize_]; }
+
+  /**
+   * @brief Get a pointer to a page in the RAM image.
+   * @param page Page index
+   * @return const uint8_t* First byte of the page
+   */
+  const uint8_t *pageData(std::size_t page) const {
+    return &image_[page * pageSize_];
+  }
+
+private:
+  i_memory_device_api &device_; ///< Backing device
+
+  std::vector<uint8_t> image_; ///< RAM copy of the device
+  std::size_t pageSize_;       ///< Page size, one record per page
+  std::size_t pages_;          ///< Pages in the log
+
+  std::array<int16_t, 255> index_;   ///< Page of each key's newest record
+  std::array<uint16_t, 255> copies_; ///< Records of each key on the device
+
+  std::size_t head_ = 0;  ///< Page the next record goes to
+  std::size_t tail_ = 0;  ///< Oldest page compaction has not reclaimed
+  std::size_t free_ = 0;  ///< Pages from head_ up to tail_
+  uint16_t sequence_ = 0; ///< Sequence number of the next record
+
+  record_store_stats stats_; ///< Store counters
+};
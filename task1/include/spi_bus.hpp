@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "driver_facade.hpp"
+
+class spi_bus;
+
+/**
+ * @brief One chip on a shared spi_bus, addressed by its own CS line.
+ *
+ * Handed out by spi_bus::attach() and used like a chip_spi_api,
+ * e.g. as the transport of an eeprom_api.
+ */
+class spi_bus_device final : public i_chip_spi_api {
+public:
+  /**
+   * @brief Construct a device handle; use spi_bus::attach() instead.
+   * @param bus Bus the chip is wired to
+   * @param pinCS Chip select pin of the chip
+   */
+  spi_bus_device(spi_bus &bus, int pinCS) : bus_(bus), pinCS_(pinCS) {}
+
+  void select() override;
+  void deselect() override;
+  uint8_t transfer(uint8_t data) override;
+  void transfer(const uint8_t *tx, uint8_t *rx, std::size_t length) override;
+  bool preempted() const override;
+
+  /**
+   * @brief Get the chip select pin.
+   * @return int CS pin number
+   */
+  int chipSelect() const { return pinCS_; }
+
+private:
+  spi_bus &bus_; ///< Bus owning the shared lines
+  int pinCS_;    ///< Chip select pin
+};
+
+/**
+ * @brief Bus manager for chips sharing SCK, MOSI and MISO.
+ *
+ * Owns the shared lines and one bit-banging engine, and hands
+ * out an spi_bus_device per CS line. At most one chip is selected
+ * at a time: selecting a chip releases the CS of whichever chip
+ * still held the bus, ending its transaction. Everything a chip
+ * does on its own, such as an EEPROM write cycle, goes on while
+ * the bus serves the other chips.
+ *
+ * A driver that keeps a transaction open between calls, like the
+ * eeprom_api read stream, sees through preempted() that another
+ * chip ended it and starts a new one. Closing it before another
+ * chip is used (eeprom_api::endSequentialRead()) saves the forced
+ * deselect; preemptions() counts the places where that was missed.
+ */
+class spi_bus {
+public:
+  /**
+   * @brief Construct the bus and put the shared lines into idle state.
+   * @param gpio Reference to GPIO driver
+   * @param pinSCK SPI clock pin
+   * @param pinMOSI SPI MOSI pin
+   * @param pinMISO SPI MISO pin
+   * @param timing Delay policy between SCK edges
+   */
+  spi_bus(i_chip_gpio_driver &gpio, int pinSCK, int pinMOSI, int pinMISO,
+          spi_timing timing = spi_timing());
+
+  spi_bus(const spi_bus &) = delete;
+  spi_bus &operator=(const spi_bus &) = delete;
+
+  /**
+   * @brief Add a chip on its own CS line.
+   *
+   * The returned handle stays valid for the lifetime of the bus.
+   *
+   * @param pinCS Chip select pin, driven high here
+   * @return spi_bus_device& Transport for the chip driver
+   */
+  spi_bus_device &attach(int pinCS);
+
+  /**
+   * @brief Get the number of attached chips.
+   * @return std::size_t Chip count
+   */
+  std::size_t size() const { return devices_.size(); }
+
+  /**
+   * @brief Get an attached chip in attach() order.
+   * @param index Chip index
+   * @return spi_bus_device& Transport of the chip
+   */
+  spi_bus_device &device(std::size_t index) { return devices_[index]; }
+
+  /**
+   * @brief Get the number of transactions cut short by another chip.
+   * @return uint64_t Forced deselects since construction
+   */
+  uint64_t preemptions() const { return preemptions_; }
+
+  /**
+   * @brief Get the bus counters of all chips together.
+   * @return spi_telemetry Snapshot of the counters
+   */
+  spi_telemetry telemetry() const { return spi_.counters().snapshot(); }
+
+  /**
+   * @brief Reset the bus counters.
+   */
+  void resetTelemetry() { spi_.counters().reset(); }
+
+private:
+  friend class spi_bus_device;
+
+  /**
+   * @brief Give the bus to a chip by pulling its CS low.
+   * @param pinCS Chip select pin
+   */
+  void select(int pinCS);
+
+  /**
+   * @brief Pull a chip's CS high and free the bus if it held it.
+   * @param pinCS Chip select pin
+   */
+  void deselect(int pinCS);
+
+private:
+  i_chip_gpio_driver &gpio_;           ///< GPIO driver, for the CS lines
+  std::deque<spi_bus_device> devices_; ///< Attached chips, stable addresses
+  int active_ = -1;                    ///< CS pin holding the bus, or -1
+  uint64_t preemptions_ = 0;           ///< Forced deselects
+
+  /// Bit-banging engine for the shared lines, CS left to the bus
+  basic_chip_spi<i_chip_gpio_driver, spi_pin_map, spi_timing,
+                 spi_default_counters>
+      spi_;
+};
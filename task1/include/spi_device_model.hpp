@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief Wiring of a simulated SPI device.
+ */
+struct spi_model_pins {
+  int cs = 0;   ///< Chip select pin
+  int sck = 1;  ///< Clock pin
+  int mosi = 2; ///< MOSI pin (device SI)
+  int miso = 3; ///< MISO pin (device SO)
+  int io2 = -1; ///< IO2 pin (/WP), -1 if not wired
+  int io3 = -1; ///< IO3 pin (/HOLD), -1 if not wired
+};
+
+/**
+ * @brief Pin-level front end shared by the simulated SPI devices.
+ *
+ * Implements i_chip_gpio_driver and turns pin activity into SPI
+ * mode 0 events: CS edges, bytes sampled on SCK rising edges and
+ * output bits shifted to MISO on SCK falling edges. Devices derive
+ * from it and only deal in whole bytes. Output can also go out on
+ * 2 or 4 data lines (IO0 = MOSI, IO1 = MISO, IO2, IO3); the master
+ * is expected to release those lines with setDirection() first,
+ * and every bit driven onto a line the master still drives is
+ * counted as contention.
+ *
+ * Port access can be advertised or not, so drivers can be
+ * measured on both the per-pin and the mask code paths. All pin
+ * operations are counted.
+ */
+class spi_device_model : public i_chip_gpio_driver {
+public:
+  void setHigh(int pin) override;
+  void setLow(int pin) override;
+  bool read(int pin) override;
+
+  bool hasPortAccess() const override { return portAccess_; }
+  void setMask(uint32_t mask) override;
+  void clearMask(uint32_t mask) override;
+  void writePort(uint32_t mask, uint32_t values) override;
+  uint32_t readMask(uint32_t mask) override;
+  void setDirection(int pin, bool output) override;
+
+  /**
+   * @brief Replay a waveform the way a DMA-capable backend would.
+   *
+   * Every edge counts as one port write and every sample as one
+   * port read, with or without advertised port access.
+   *
+   * @param edges Edge list, see spi_waveform
+   * @param count Number of edges
+   * @param sampleMask Input pins to sample
+   * @param rxOut Buffer for one byte per 8 samples, or nullptr
+   */
+  void submit(const gpio_edge *edges, std::size_t count,
+              uint32_t sampleMask, uint8_t *rxOut) override;
+
+  /**
+   * @brief Get the number of pin level changes requested.
+   *
+   * A port write counts once, however many pins it touches.
+   *
+   * @return uint64_t Pin write operations since the last reset
+   */
+  uint64_t pinWrites() const { return pinWrites_; }
+
+  /**
+   * @brief Get the number of pin reads.
+   *
+   * A port read counts once, however many pins it samples.
+   *
+   * @return uint64_t Pin read operations since the last reset
+   */
+  uint64_t pinReads() const { return pinReads_; }
+
+  /**
+   * @brief Get the number of bits driven against the master.
+   * @return uint64_t Contended output bits since the last reset
+   */
+  uint64_t contentions() const { return contentions_; }
+
+  /**
+   * @brief Reset the pin operation counters.
+   */
+  virtual void resetCounters();
+
+protected:
+  /**
+   * @brief Construct the front end with the bus idle.
+   * @param pins Wiring
+   * @param portAccess Advertise setMask/writePort
+   */
+  spi_device_model(spi_model_pins pins, bool portAccess);
+
+  /**
+   * @brief Called on the CS falling edge.
+   */
+  virtual void onSelect() = 0;
+
+  /**
+   * @brief Called for every byte received while selected.
+   * @param byte Received byte
+   */
+  virtual void onByte(uint8_t byte) = 0;
+
+  /**
+   * @brief Called on the CS rising edge.
+   * @param aligned CS rose on a byte boundary
+   */
+  virtual void onDeselect(bool aligned) = 0;
+
+  /**
+   * @brief Supply the next byte of an output stream.
+   *
+   * Called when the previous byte has been shifted out and
+   * the master keeps clocking.
+   *
+   * @return uint8_t Next output byte
+   */
+  virtual uint8_t nextOutput() = 0;
+
+  /**
+   * @brief Start output, MSB first from the next falling edge.
+   * @param byte First output byte
+   * @param width Data lines to drive: 1 (MISO only), 2 or 4
+   */
+  void startOutput(uint8_t byte, unsigned width = 1);
+
+  /**
+   * @brief Get the number of bits received in this CS window.
+   * @return int Bit count
+   */
+  int bitsReceived() const { return bitsIn_; }
+
+private:
+  /**
+   * @brief Apply new levels of the bus pins in electrical order.
+   * @param cs New CS level
+   * @param sck New SCK level
+   * @param mosi New MOSI level
+   */
+  void apply(bool cs, bool sck, bool mosi);
+
+  /**
+   * @brief Map a pin number to its data line.
+   * @param pin Pin number
+   * @return int Line 0..3, or -1 if the pin is not a data line
+   */
+  int lineOf(int pin) const;
+
+  /**
+   * @brief Get the level of a pin without counting the access.
+   * @param pin Pin number
+   * @return bool Pin level
+   */
+  bool level(int pin) const;
+
+  /**
+   * @brief Sample MOSI on the SCK rising edge.
+   */
+  void onRisingEdge();
+
+  /**
+   * @brief Shift the next output bit to MISO on the SCK falling edge.
+   */
+  void onFallingEdge();
+
+private:
+  spi_model_pins pins_; ///< Wiring
+  bool portAccess_;     ///< Advertise setMask/writePort
+
+  bool cs_ = true;    ///< CS level, idle high
+  bool sck_ = false;  ///< SCK level
+  bool io_[4] = {};   ///< Master levels of the data lines, io_[0] is MOSI
+  bool masterDrives_[4] = {true, false, true, true}; ///< Master outputs
+
+  uint8_t shiftIn_ = 0; ///< MOSI shift register
+  int bitsIn_ = 0;      ///< Bits received in this window
+
+  bool outputActive_ = false; ///< Output stream running
+  unsigned outWidth_ = 1;     ///< Data lines of the output stream
+  uint8_t out_ = 0;           ///< Byte being shifted out
+  unsigned bitsOut_ = 8;      ///< Bits of out_ already shifted
+  uint8_t drivenMask_ = 0;    ///< Lines the device drives
+  bool driven_[4] = {};       ///< Levels the device drives
+
+  uint64_t pinWrites_ = 0;   ///< Pin write operations
+  uint64_t pinReads_ = 0;    ///< Pin read operations
+  uint64_t contentions_ = 0; ///< Bits driven against the master
+};
+
+/**
+ * @brief GPIO driver wiring several device models to the same pins.
+ *
+ * Every pin write reaches every model and a read returns the OR
+ * of their levels, high impedance reading as low. That is how
+ * chips sharing SCK/MOSI/MISO on separate CS lines look to the
+ * master, so a bus of models can be driven through spi_bus.
+ */
+class spi_model_bus final : public i_chip_gpio_driver {
+public:
+  /**
+   * @brief Construct an empty bus.
+   * @param portAccess Advertise setMask/writePort
+   */
+  explicit spi_model_bus(bool portAccess = true) : portAccess_(portAccess) {}
+
+  /**
+   * @brief Wire a model to the bus.
+   * @param model Device model, must outlive the bus
+   */
+  void attach(spi_device_model &model) { models_.push_back(&model); }
+
+  void setHigh(int pin) override;
+  void setLow(int pin) override;
+  bool read(int pin) override;
+
+  bool hasPortAccess() const override { return portAccess_; }
+  void setMask(uint32_t mask) override;
+  void clearMask(uint32_t mask) override;
+  void writePort(uint32_t mask, uint32_t values) override;
+  uint32_t readMask(uint32_t mask) override;
+  void setDirection(int pin, bool output) override;
+
+private:
+  std::vector<spi_device_model *> models_; ///< Wired models
+  bool portAccess_;                        ///< Advertise setMask/writePort
+};
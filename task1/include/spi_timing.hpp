@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Delay policy between SCK edges of a bit-banged SPI bus.
+ *
+ * One SCK period consists of two half periods; the policy
+ * decides how the time between edges is spent.
+ */
+class spi_timing {
+public:
+  /**
+   * @brief How a half period is spent.
+   */
+  enum class mode {
+    none,      ///< No delay, the bus runs as fast as the GPIO driver
+    busy_wait, ///< Calibrated steady_clock spin, sub-microsecond resolution
+    sleep,     ///< std::this_thread::sleep_for, scheduler resolution
+  };
+
+  static constexpr uint32_t DEFAULT_SCK_HZ = 500'000; ///< Default SCK rate
+
+  /**
+   * @brief Construct a timing policy.
+   *
+   * The busy-wait mode triggers the clock calibration
+   * on first use.
+   *
+   * @param delayMode How to spend each half period
+   * @param sckHz Target SCK frequency in Hz
+   */
+  explicit spi_timing(mode delayMode = mode::busy_wait,
+                      uint32_t sckHz = DEFAULT_SCK_HZ);
+
+  /**
+   * @brief Change the target SCK frequency.
+   * @param sckHz Target SCK frequency in Hz, 0 disables the delay
+   */
+  void setFrequency(uint32_t sckHz);
+
+  /**
+   * @brief Get the target SCK frequency.
+   * @return uint32_t SCK frequency in Hz
+   */
+  uint32_t frequency() const { return sckHz_; }
+
+  /**
+   * @brief Get the delay mode.
+   * @return mode Current delay mode
+   */
+  mode delayMode() const { return mode_; }
+
+  /**
+   * @brief Wait for half an SCK period.
+   */
+  void halfPeriod() const {
+    switch (mode_) {
+    case mode::none:
+      return;
+    case mode::busy_wait:
+      busyWait();
+      return;
+    case mode::sleep:
+      sleepHalfPeriod();
+      return;
+    }
+  }
+
+  /**
+   * @brief Measure the cost of reading steady_clock on this machine.
+   *
+   * Runs once per process; later calls return the cached value.
+   *
+   * @return std::chrono::nanoseconds Cost of one steady_clock::now()
+   */
+  static std::chrono::nanoseconds clockOverhead();
+
+private:
+  /**
+   * @brief Spin on steady_clock until the calibrated wait has passed.
+   */
+  void busyWait() const {
+    if (wait_.count() <= 0)
+      return;
+
+    auto deadline = std::chrono::steady_clock::now() + wait_;
+    while (std::chrono::steady_clock::now() < deadline) {
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  /**
+   * @brief Sleep for half an SCK period.
+   */
+  void sleepHalfPeriod() const;
+
+  mode mode_;                        ///< Delay mode
+  uint32_t sckHz_;                   ///< Target SCK frequency
+  std::chrono::nanoseconds half_{0}; ///< Half period duration
+  std::chrono::nanoseconds wait_{0}; ///< Busy-wait minus clock overhead
+};
+
+/**
+ * @brief Zero-cost timing policy for statically specialized SPI masters.
+ *
+ * Equivalent to spi_timing::mode::none without the run-time switch.
+ */
+struct spi_no_delay {
+  /**
+   * @brief Do nothing; the bus runs at GPIO speed.
+   */
+  void halfPeriod() const {}
+};
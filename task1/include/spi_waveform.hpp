@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief One step of a precompiled pin waveform.
+ *
+ * Drives the masked pins to their levels in a single port write,
+ * then optionally samples the input pins.
+ */
+struct gpio_edge {
+  uint32_t mask;   ///< Pins the step drives, bit n for pin n
+  uint32_t values; ///< Levels of the driven pins
+  bool sample;     ///< Sample the input pins after the write
+};
+
+/**
+ * @brief Compiler of whole SPI mode 0 transactions into edge lists.
+ *
+ * A transaction becomes CS low, two edges per bit (SCK low with
+ * the MOSI level, then SCK high followed by a MISO sample) and
+ * SCK low with CS high. Bytes are expanded through a table of the
+ * 16 possible nibbles, so compiling costs two block copies per
+ * byte. The list goes to i_chip_gpio_driver::submit() in one call,
+ * which a backend can replay from a tight loop or hand to DMA.
+ *
+ * All pins must be in 0..31 to fit a port mask.
+ */
+class spi_waveform {
+public:
+  static constexpr std::size_t EDGES_PER_BYTE = 16; ///< Two per bit
+
+  /**
+   * @brief Construct the compiler and build the nibble table.
+   * @param pinCS Chip select pin
+   * @param pinSCK SPI clock pin
+   * @param pinMOSI SPI MOSI pin
+   */
+  spi_waveform(int pinCS, int pinSCK, int pinMOSI);
+
+  /**
+   * @brief Tell whether a pin can be driven by a waveform.
+   * @param pin Pin number
+   * @return true if 0 <= pin < 32
+   */
+  static constexpr bool fits(int pin) { return pin >= 0 && pin < 32; }
+
+  /**
+   * @brief Compile a whole transaction, replacing the previous one.
+   *
+   * Every byte yields 8 samples, MSB first, so the received bytes
+   * come out of submit() in transfer order.
+   *
+   * @param tx Bytes to send, or nullptr to send 0x00
+   * @param length Number of bytes
+   */
+  void compile(const uint8_t *tx, std::size_t length);
+
+  /**
+   * @brief Get the compiled edges.
+   * @return const gpio_edge* First edge
+   */
+  const gpio_edge *data() const { return edges_.data(); }
+
+  /**
+   * @brief Get the number of compiled edges.
+   * @return std::size_t Edge count
+   */
+  std::size_t size() const { return edges_.size(); }
+
+  /**
+   * @brief Count the pin writes of the waveform without port access.
+   * @return std::size_t Pins driven over all edges
+   */
+  std::size_t pinWrites() const;
+
+private:
+  /// Edges of the four bits of one nibble
+  using nibble_edges = std::array<gpio_edge, EDGES_PER_BYTE / 2>;
+
+  uint32_t maskCS_;   ///< CS pin mask
+  uint32_t maskSCK_;  ///< SCK pin mask
+  uint32_t maskMOSI_; ///< MOSI pin mask
+
+  std::array<nibble_edges, 16> nibbles_; ///< Edges of every nibble value
+  std::vector<gpio_edge> edges_;         ///< Compiled transaction
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "driver_facade.hpp"
+
+/**
+ * @brief Several EEPROMs presented as one larger memory device.
+ *
+ * Pages are interleaved across the chips: logical page p lives in
+ * chip p % N at page p / N. Every chip runs in deferred ready
+ * mode, so a buffer write clocks a page into each chip in turn
+ * and only waits when it comes back to a chip still in its write
+ * cycle; with N chips on one spi_bus, N write cycles overlap.
+ * Buffer reads visit one chip at a time, whose pages of the range
+ * are contiguous and come out of a single READ stream.
+ */
+class striped_memory_device final : public i_memory_device_api {
+public:
+  /// Most chips the 16-bit address space can hold
+  static constexpr std::size_t MAX_CHIPS =
+      (std::size_t{1} << 16) / eeprom_api::MEMORY_SIZE;
+
+  /**
+   * @brief Construct the striped device and enable deferred ready mode.
+   * @param chips Drivers of 1 to MAX_CHIPS chips, must outlive the device
+   * @throw std::invalid_argument if the chip count is out of range or a
+   * driver is null
+   */
+  explicit striped_memory_device(std::vector<eeprom_api *> chips);
+
+  /**
+   * @brief Wait for the outstanding write cycles.
+   */
+  ~striped_memory_device() override;
+
+  void writeByte(uint16_t address, uint8_t data) override;
+  uint8_t readByte(uint16_t address) override;
+
+  void writeBuffer(uint16_t address, const uint8_t *data,
+                   std::size_t length) override;
+  void readBuffer(uint16_t address, uint8_t *buffer,
+                  std::size_t length) override;
+
+  void writeBit(uint16_t address, uint8_t bitPosition, bool value) override;
+  bool readBit(uint16_t address, uint8_t bitPosition) override;
+
+  using i_memory_device_api::updateBits;
+  void updateBits(uint16_t address, uint8_t mask, uint8_t values) override;
+
+  /**
+   * @brief Wait until every chip finished its write cycle.
+   */
+  void sync();
+
+  /**
+   * @brief Get the size of the striped device.
+   * @return std::size_t Capacity in bytes
+   */
+  std::size_t capacity() const { return chips_.size() * CHIP_SIZE; }
+
+  /**
+   * @brief Get the number of chips.
+   * @return std::size_t Chip count
+   */
+  std::size_t chipCount() const { return chips_.size(); }
+
+private:
+  static constexpr std::size_t CHIP_SIZE = eeprom_api::MEMORY_SIZE;
+  static constexpr std::size_t PAGE_SIZE = eeprom_api::PAGE_SIZE;
+
+  /**
+   * @brief Chip and chip address of a logical address.
+   */
+  struct location {
+    std::size_t chip; ///< Chip index
+    uint16_t address; ///< Address inside the chip
+  };
+
+  /**
+   * @brief Map a logical address to its chip.
+   * @param address Logical address, wrapped to the capacity
+   * @return location Chip and chip address
+   */
+  location locate(std::size_t address) const;
+
+  /**
+   * @brief Get a chip driver, closing the read stream of another chip.
+   * @param chip Chip index
+   * @return eeprom_api& Driver of the chip
+   */
+  eeprom_api &use(std::size_t chip);
+
+private:
+  std::vector<eeprom_api *> chips_; ///< Chip drivers in stripe order
+  std::size_t active_ = 0;          ///< Chip that may hold the bus
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+ * Telemetry is on unless the build says otherwise;
+ * with DRIVER_FACADE_TELEMETRY=0 every hook below
+ * compiles to nothing and snapshots read as zero.
+ * */
+#ifndef DRIVER_FACADE_TELEMETRY
+#define DRIVER_FACADE_TELEMETRY 1
+#endif
+
+/**
+ * @brief Counter that may be read from another thread.
+ *
+ * Relaxed atomics: values are statistics, not synchronization.
+ */
+class telemetry_counter {
+public:
+  /**
+   * @brief Add to the counter.
+   * @param n Amount to add
+   */
+  void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the current value.
+   * @return uint64_t Counter value
+   */
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Set the counter back to zero.
+   */
+  void reset() { value_.store(0, std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{0}; ///< Current value
+};
+
+/**
+ * @brief Plain copy of a latency histogram.
+ *
+ * Bucket i counts durations in [2^i, 2^(i+1)) ns; bucket 0 also
+ * takes anything below 1 ns and the last bucket everything above
+ * its lower bound.
+ */
+struct latency_histogram {
+  static constexpr std::size_t BUCKETS = 32; ///< Number of log2 buckets
+
+  std::array<uint64_t, BUCKETS> counts{}; ///< Samples per bucket
+
+  /**
+   * @brief Get the number of recorded samples.
+   * @return uint64_t Sum over all buckets
+   */
+  uint64_t total() const;
+
+  /**
+   * @brief Find the bucket a duration falls into.
+   * @param duration Measured latency
+   * @return std::size_t Bucket index
+   */
+  static std::size_t bucketOf(std::chrono::nanoseconds duration);
+
+  /**
+   * @brief Get the smallest duration counted by a bucket.
+   * @param bucket Bucket index
+   * @return std::chrono::nanoseconds Lower bound of the bucket
+   */
+  static std::chrono::nanoseconds lowerBound(std::size_t bucket);
+};
+
+/**
+ * @brief Log2 latency histogram that may be scraped from another thread.
+ */
+class telemetry_histogram {
+public:
+  /**
+   * @brief Record one sample.
+   * @param duration Measured latency
+   */
+  void record(std::chrono::nanoseconds duration);
+
+  /**
+   * @brief Copy the current bucket counts.
+   * @return latency_histogram Snapshot
+   */
+  latency_histogram snapshot() const;
+
+  /**
+   * @brief Clear all buckets.
+   */
+  void reset();
+
+private:
+  /// Samples per bucket
+  std::array<telemetry_counter, latency_histogram::BUCKETS> buckets_;
+};
+
+/**
+ * @brief Bus counters of an SPI master.
+ */
+struct spi_telemetry {
+  uint64_t transactions = 0; ///< select/deselect pairs
+  uint64_t bytes = 0;        ///< Bytes clocked in full duplex
+  uint64_t gpioToggles = 0;  ///< GPIO writes issued, port writes count once
+};
+
+/**
+ * @brief Counter policy for basic_chip_spi that records bus activity.
+ */
+struct spi_counters {
+  static constexpr bool enabled = true; ///< Hooks are live
+
+  /// Count a select/deselect pair
+  void onTransaction() { transactions_.add(); }
+  /// Count bytes clocked in one transfer
+  void onBytes(std::size_t n) { bytes_.add(n); }
+  /// Count GPIO writes accumulated during one call
+  void onGpio(uint64_t n) { gpioToggles_.add(n); }
+
+  /**
+   * @brief Copy the counters.
+   * @return spi_telemetry Snapshot
+   */
+  spi_telemetry snapshot() const {
+    return {transactions_.value(), bytes_.value(), gpioToggles_.value()};
+  }
+
+  /**
+   * @brief Clear the counters.
+   */
+  void reset() {
+    transactions_.reset();
+    bytes_.reset();
+    gpioToggles_.reset();
+  }
+
+private:
+  telemetry_counter transactions_; ///< select/deselect pairs
+  telemetry_counter bytes_;        ///< Bytes clocked
+  telemetry_counter gpioToggles_;  ///< GPIO writes
+};
+
+/**
+ * @brief Counter policy for basic_chip_spi that records nothing.
+ */
+struct spi_no_counters {
+  static constexpr bool enabled = false; ///< Hooks compile away
+
+  void onTransaction() {}                       ///< No-op
+  void onBytes(std::size_t) {}                  ///< No-op
+  void onGpio(uint64_t) {}                      ///< No-op
+  spi_telemetry snapshot() const { return {}; } ///< Always zero
+  void reset() {}                               ///< No-op
+};
+
+/// Counter policy chip_spi_api builds with
+using spi_default_counters =
+    std::conditional_t<DRIVER_FACADE_TELEMETRY, spi_counters, spi_no_counters>;
+
+/**
+ * @brief Public eeprom_api calls with their own latency histogram.
+ */
+enum class eeprom_call : std::size_t {
+  readByte,
+  writeByte,
+  readBuffer,
+  writeBuffer,
+  readBit,
+  writeBit,
+  updateBits,
+  count ///< Number of tracked calls
+};
+
+/**
+ * @brief Scrapeable call latencies of an eeprom_api.
+ *
+ * Status polls and ready-wait time live in eeprom_ready_stats.
+ */
+struct eeprom_telemetry {
+  /// Latency per public call, indexed by eeprom_call
+  std::array<latency_histogram, static_cast<std::size_t>(eeprom_call::count)>
+      latency{};
+
+  /**
+   * @brief Get the histogram of one call.
+   * @param call Public call
+   * @return const latency_histogram& Histogram
+   */
+  const latency_histogram &of(eeprom_call call) const {
+    return latency[static_cast<std::size_t>(call)];
+  }
+};
@@ -0,0 +1,396 @@
+#include "async_memory_device.hpp"
+#include <algorithm>
+
+/**
+ * @brief Construct the front end and start the worker thread.
+ *
+ * @param device Device owned by the worker from now on
+ * @param mergeWindow Time the worker waits for more requests, 0 = none
+ * @param capacity Device size in bytes
+ */
+async_memory_device::async_memory_device(i_memory_device_api &device,
+                                         std::chrono::microseconds mergeWindow,
+                                         std::size_t capacity)
+    : device_(device), mergeWindow_(mergeWindow), capacity_(capacity),
+      worker_(&async_memory_device::run, this) {}
+
+/**
+ * @brief Drain the queue and stop the worker thread.
+ *
+ * The worker finishes every queued request before it exits.
+ */
+async_memory_device::~async_memory_device() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  worker_.join();
+}
+
+/**
+ * @brief Queue a single byte write.
+ *
+ * @param address Memory address to write to
+ * @param data Byte to write
+ * @return std::future<void> Ready once the byte is programmed
+ */
+std::future<void> async_memory_device::writeByte(uint16_t address,
+                                                 uint8_t data) {
+  return writeBuffer(address, &data, 1);
+}
+
+/**
+ * @brief Queue a buffer write.
+ *
+ * @param address Starting memory address
+ * @param data Pointer to data buffer, copied before returning
+ * @param length Number of bytes to write
+ * @return std::future<void> Ready once the data is programmed
+ */
+std::future<void> async_memory_device::writeBuffer(uint16_t address,
+                                                   const uint8_t *data,
+                                                   std::size_t length) {
+  write_request request{0, address, {data, data + length}, {}, {}};
+  std::future<void> done = request.done.get_future();
+  submit(std::move(request));
+  return done;
+}
+
+/**
+ * @brief Queue a buffer write with a completion callback.
+ *
+ * @param address Starting memory address
+ * @param data Pointer to data buffer, copied before returning
+ * @param length Number of bytes to write
+ * @param done Called on the worker thread once the data is programmed
+ */
+void async_memory_device::writeBuffer(uint16_t address, const uint8_t *data,
+                                      std::size_t length, completion done) {
+  submit({0, address, {data, data + length}, {}, std::move(done)});
+}
+
+/**
+ * @brief Put a write on the queue and wake the worker.
+ *
+ * @param request Write request
+ */
+void async_memory_device::submit(write_request request) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    arrived();
+    request.sequence = sequence_++;
+    request.address = static_cast<uint16_t>(request.address % capacity_);
+    writes_.push_back(std::move(request));
+  }
+  wake_.notify_one();
+}
+
+/**
+ * @brief Read a single byte, seeing all previously queued writes.
+ *
+ * @param address Memory address to read
+ * @return uint8_t Value read from memory
+ */
+uint8_t async_memory_device::readByte(uint16_t address) {
+  uint8_t data;
+  readBuffer(address, &data, 1);
+  return data;
+}
+
+/**
+ * @brief Read a buffer, seeing all previously queued writes.
+ *
+ * The read is served ahead of pending writes; blocks until the
+ * worker has filled the buffer.
+ *
+ * @param address Starting memory address
+ * @param buffer Pointer to buffer to store data
+ * @param length Number of bytes to read
+ */
+void async_memory_device::readBuffer(uint16_t address, uint8_t *buffer,
+                                     std::size_t length) {
+  std::future<void> done;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    arrived();
+    reads_.push_back({sequence_++,
+                      static_cast<uint16_t>(address % capacity_), buffer,
+                      length, {}});
+    done = reads_.back().done.get_future();
+  }
+  wake_.notify_one();
+  done.wait();
+}
+
+/**
+ * @brief Block until every queued request has completed.
+ */
+void async_memory_device::drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock,
+             [this] { return writes_.empty() && reads_.empty() && !busy_; });
+}
+
+/**
+ * @brief Get the number of device writes issued by the worker.
+ *
+ * @return uint64_t Merged write count
+ */
+uint64_t async_memory_device::deviceWrites() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return deviceWrites_;
+}
+
+/**
+ * @brief Get the number of device reads issued by the worker.
+ *
+ * @return uint64_t Merged read count
+ */
+uint64_t async_memory_device::deviceReads() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return deviceReads_;
+}
+
+/**
+ * @brief Note the arrival of a request; call with the mutex held.
+ *
+ * Only a request finding the worker idle opens a merge window;
+ * requests arriving while the worker is busy queue up anyway.
+ */
+void async_memory_device::arrived() {
+  if (writes_.empty() && reads_.empty() && !busy_)
+    firstArrival_ = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Worker thread main loop.
+ *
+ * Waits out the merge window, then serves every queued read as
+ * one batch; reads go first to keep their latency low. Otherwise
+ * every queued write is taken as one batch. The device is only
+ * touched with the mutex released.
+ */
+void async_memory_device::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this] {
+      return stop_ || !reads_.empty() || !writes_.empty();
+    });
+
+    if (mergeWindow_.count() > 0)
+      wake_.wait_until(lock, firstArrival_ + mergeWindow_,
+                       [this] { return stop_; });
+
+    if (!reads_.empty()) {
+      std::vector<read_request> batch(std::make_move_iterator(reads_.begin()),
+                                      std::make_move_iterator(reads_.end()));
+      reads_.clear();
+      busy_ = true;
+
+      lock.unlock();
+      uint64_t issued = fetch(batch);
+      lock.lock();
+
+      deviceReads_ += issued;
+      for (auto &request : batch)
+        serve(request);
+      busy_ = false;
+    } else if (!writes_.empty()) {
+      std::vector<write_request> batch(std::make_move_iterator(writes_.begin()),
+                                       std::make_move_iterator(writes_.end()));
+      writes_.clear();
+      busy_ = true;
+
+      lock.unlock();
+      flush(batch);
+      lock.lock();
+
+      busy_ = false;
+    } else if (stop_) {
+      break;
+    }
+
+    if (writes_.empty() && reads_.empty())
+      idle_.notify_all();
+  }
+}
+
+/**
+ * @brief Read a batch with one device read per contiguous span.
+ *
+ * Requests are sorted by address; a request starting at or
+ * before the end of the current span extends it. Each span is
+ * read once and sliced into the callers' buffers. A span running
+ * past the end of the device wraps inside the device read.
+ *
+ * @param batch Reads, sorted by address on return
+ * @return uint64_t Device reads issued
+ */
+uint64_t async_memory_device::fetch(std::vector<read_request> &batch) {
+  std::sort(batch.begin(), batch.end(),
+            [](const read_request &a, const read_request &b) {
+              return a.address < b.address;
+            });
+
+  uint64_t issued = 0;
+  std::vector<uint8_t> span;
+  std::size_t i = 0;
+  while (i < batch.size()) {
+    std::size_t begin = batch[i].address;
+    std::size_t end = begin + batch[i].length;
+    std::size_t last = i + 1;
+    while (last < batch.size() && batch[last].address <= end) {
+      end = std::max(end, batch[last].address + batch[last].length);
+      ++last;
+    }
+
+    span.resize(end - begin);
+    device_.readBuffer(static_cast<uint16_t>(begin), span.data(), span.size());
+    ++issued;
+
+    for (; i < last; ++i)
+      std::copy_n(span.begin() + (batch[i].address - begin), batch[i].length,
+                  batch[i].buffer);
+  }
+  return issued;
+}
+
+/**
+ * @brief Complete a read by overlaying pending writes.
+ *
+ * Called with the mutex held, after the batch was fetched. Every
+ * write submitted before the read and still queued is copied
+ * over the device data in submission order.
+ *
+ * @param request Read request
+ */
+void async_memory_device::serve(read_request &request) {
+  for (const auto &write : writes_) {
+    if (write.sequence < request.sequence)
+      overlay(write, request.address, request.buffer, request.length);
+  }
+  request.done.set_value();
+}
+
+/**
+ * @brief Copy the part of a write that overlaps a read range.
+ *
+ * Both ranges are taken modulo the device size. The write is
+ * walked in runs that do not cross the end of the device; each
+ * run lands at a fixed offset from the read start, and again at
+ * every multiple of the device size for reads longer than it.
+ *
+ * @param write Pending write
+ * @param address Start of the read range
+ * @param buffer Read buffer
+ * @param length Length of the read range
+ */
+void async_memory_device::overlay(const write_request &write,
+                                  std::size_t address, uint8_t *buffer,
+                                  std::size_t length) const {
+  std::size_t shift = (write.address + capacity_ - address) % capacity_;
+
+  std::size_t done = 0;
+  while (done < write.data.size()) {
+    std::size_t offset = (shift + done) % capacity_;
+    std::size_t run =
+        std::min(write.data.size() - done, capacity_ - offset);
+
+    for (std::size_t at = offset; at < length; at += capacity_)
+      std::copy_n(write.data.begin() + done, std::min(run, length - at),
+                  buffer + at);
+    done += run;
+  }
+}
+
+/**
+ * @brief Fold one non-wrapping write segment into the extents.
+ *
+ * The segment absorbs every extent it overlaps or touches and
+ * its bytes win.
+ *
+ * @param extents Extents built so far, disjoint and not touching
+ * @param address Start of the segment, below the device size
+ * @param data Segment bytes
+ * @param length Segment length, not past the end of the device
+ */
+void async_memory_device::fold(std::vector<extent> &extents,
+                               std::size_t address, const uint8_t *data,
+                               std::size_t length) {
+  std::size_t begin = address;
+  std::size_t end = begin + length;
+
+  extent merged{begin, {}};
+  std::vector<extent> absorbed;
+  for (auto it = extents.begin(); it != extents.end();) {
+    std::size_t itEnd = it->address + it->data.size();
+    if (it->address <= end && begin <= itEnd) {
+      begin = std::min(begin, it->address);
+      end = std::max(end, itEnd);
+      absorbed.push_back(std::move(*it));
+      it = extents.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  merged.address = begin;
+  merged.data.resize(end - begin);
+  for (const auto &old : absorbed)
+    std::copy(old.data.begin(), old.data.end(),
+              merged.data.begin() + (old.address - begin));
+  std::copy_n(data, length, merged.data.begin() + (address - begin));
+
+  extents.push_back(std::move(merged));
+}
+
+/**
+ * @brief Merge a batch of writes and hand it to the device.
+ *
+ * Writes are folded into extents in submission order: a write
+ * that overlaps or touches existing extents absorbs them and
+ * its bytes win. A write running past the end of the device is
+ * split there and folded segment by segment, so no extent wraps
+ * and the sorted extents can be written in any order. Each
+ * resulting extent is one device write, which the device splits
+ * into page writes.
+ *
+ * @param batch Writes in submission order
+ */
+void async_memory_device::flush(std::vector<write_request> &batch) {
+  std::vector<extent> extents;
+
+  for (const auto &write : batch) {
+    std::size_t address = write.address;
+    std::size_t done = 0;
+    while (done < write.data.size()) {
+      std::size_t run =
+          std::min(write.data.size() - done, capacity_ - address);
+      fold(extents, address, write.data.data() + done, run);
+      address = 0;
+      done += run;
+    }
+  }
+
+  std::sort(extents.begin(), extents.end(),
+            [](const extent &a, const extent &b) {
+              return a.address < b.address;
+            });
+
+  for (const auto &range : extents) {
+    device_.writeBuffer(static_cast<uint16_t>(range.address),
+                        range.data.data(), range.data.size());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deviceWrites_ += extents.size();
+  }
+
+  for (auto &write : batch) {
+    if (write.callback)
+      write.callback();
+    write.done.set_value();
+  }
+}
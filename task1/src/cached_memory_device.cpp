@@ -0,0 +1,218 @@
+#include "cached_memory_device.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief Construct a cache over a memory device.
+ *
+ * The image is not read until the first access. The dirty bitmap
+ * and flush() only know whole pages, and addresses are 16-bit, so
+ * the geometry is checked here.
+ *
+ * @param device Backing device
+ * @param flushThreshold Dirty page count that triggers flush(), 0 = never
+ * @param capacity Device size in bytes, a multiple of pageSize, at most
+ * 64 KB
+ * @param pageSize Device write page size in bytes
+ * @throw std::invalid_argument if the geometry is not usable
+ */
+cached_memory_device::cached_memory_device(i_memory_device_api &device,
+                                           std::size_t flushThreshold,
+                                           std::size_t capacity,
+                                           std::size_t pageSize)
+    : device_(device), image_(capacity),
+      dirty_(pageSize ? (capacity / pageSize + 31) / 32 : 0),
+      pageSize_(pageSize), flushThreshold_(flushThreshold) {
+  if (pageSize == 0 || capacity == 0 || capacity % pageSize != 0)
+    throw std::invalid_argument(
+        "cached_memory_device: capacity must be whole pages");
+  if (capacity > (std::size_t{1} << 16))
+    throw std::invalid_argument("cached_memory_device: at most 64 KB");
+}
+
+/**
+ * @brief Write back any dirty pages before the cache goes away.
+ */
+cached_memory_device::~cached_memory_device() { flush(); }
+
+/**
+ * @brief Fill the image from the device with one sequential read.
+ */
+void cached_memory_device::load() {
+  if (loaded_)
+    return;
+
+  device_.readBuffer(0, image_.data(), image_.size());
+  loaded_ = true;
+}
+
+/**
+ * @brief Mark the pages covering a byte range as dirty.
+ *
+ * @param offset Image offset of the first byte
+ * @param length Number of bytes, must not wrap
+ */
+void cached_memory_device::markDirty(std::size_t offset, std::size_t length) {
+  if (length == 0)
+    return;
+
+  std::size_t first = offset / pageSize_;
+  std::size_t last = (offset + length - 1) / pageSize_;
+  for (std::size_t page = first; page <= last; ++page) {
+    if (isDirty(page))
+      continue;
+    dirty_[page / 32] |= uint32_t{1} << (page % 32);
+    ++dirtyCount_;
+  }
+}
+
+/**
+ * @brief Tell whether a page is dirty.
+ *
+ * @param page Page index
+ * @return true if the page has to be written back
+ */
+bool cached_memory_device::isDirty(std::size_t page) const {
+  return (dirty_[page / 32] >> (page % 32)) & 0x1;
+}
+
+/**
+ * @brief Flush if the dirty page count reached the threshold.
+ */
+void cached_memory_device::flushIfNeeded() {
+  if (flushThreshold_ != 0 && dirtyCount_ >= flushThreshold_)
+    flush();
+}
+
+/**
+ * @brief Write all dirty pages back to the device.
+ *
+ * Adjacent dirty pages are handed to the device as one
+ * buffer write; the device splits it into page writes.
+ */
+void cached_memory_device::flush() {
+  if (dirtyCount_ == 0)
+    return;
+
+  std::size_t pages = image_.size() / pageSize_;
+  std::size_t page = 0;
+  while (page < pages) {
+    if (!isDirty(page)) {
+      ++page;
+      continue;
+    }
+
+    std::size_t first = page;
+    while (page < pages && isDirty(page))
+      ++page;
+
+    std::size_t offset = first * pageSize_;
+    device_.writeBuffer(static_cast<uint16_t>(offset), image_.data() + offset,
+                        (page - first) * pageSize_);
+  }
+
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  dirtyCount_ = 0;
+}
+
+/**
+ * @brief Write a single byte into the image.
+ *
+ * @param address Memory address to write to
+ * @param data Byte to write
+ */
+void cached_memory_device::writeByte(uint16_t address, uint8_t data) {
+  writeBuffer(address, &data, 1);
+}
+
+/**
+ * @brief Read a single byte from the image.
+ *
+ * @param address Memory address to read
+ * @return uint8_t Value read from memory
+ */
+uint8_t cached_memory_device::readByte(uint16_t address) {
+  load();
+  return image_[address % image_.size()];
+}
+
+/**
+ * @brief Write multiple bytes into the image.
+ *
+ * Wraps from the end of the device to address 0, the same
+ * way the device itself addresses memory.
+ *
+ * @param address Starting memory address
+ * @param data Pointer to data buffer
+ * @param length Number of bytes to write
+ */
+void cached_memory_device::writeBuffer(uint16_t address, const uint8_t *data,
+                                       std::size_t length) {
+  load();
+
+  std::size_t offset = address % image_.size();
+  while (length > 0) {
+    std::size_t chunk = std::min(length, image_.size() - offset);
+    if (!std::equal(data, data + chunk, image_.begin() + offset)) {
+      std::copy(data, data + chunk, image_.begin() + offset);
+      markDirty(offset, chunk);
+    }
+
+    offset = 0;
+    data += chunk;
+    length -= chunk;
+  }
+
+  flushIfNeeded();
+}
+
+/**
+ * @brief Read multiple bytes from the image.
+ *
+ * @param address Starting memory address
+ * @param buffer Pointer to buffer to store data
+ * @param length Number of bytes to read
+ */
+void cached_memory_device::readBuffer(uint16_t address, uint8_t *buffer,
+                                      std::size_t length) {
+  load();
+
+  std::size_t offset = address % image_.size();
+  while (length > 0) {
+    std::size_t chunk = std::min(length, image_.size() - offset);
+    std::copy_n(image_.begin() + offset, chunk, buffer);
+
+    offset = 0;
+    buffer += chunk;
+    length -= chunk;
+  }
+}
+
+/**
+ * @brief Write a single bit into the image.
+ *
+ * @param address Memory address
+ * @param bitPosition Bit index (0-7)
+ * @param value Boolean value to write
+ */
+void cached_memory_device::writeBit(uint16_t address, uint8_t bitPosition,
+                                    bool value) {
+  uint8_t byte = readByte(address);
+  if (value)
+    byte |= (1 << bitPosition);
+  else
+    byte &= ~(1 << bitPosition);
+  writeByte(address, byte);
+}
+
+/**
+ * @brief Read a single bit from the image.
+ *
+ * @param address Memory address
+ * @param bitPosition Bit index (0-7)
+ * @return true if bit is 1, false if 0
+ */
+bool cached_memory_device::readBit(uint16_t address, uint8_t bitPosition) {
+  uint8_t byte = readByte(address);
+  return (byte >> bitPosition) & 0x01;
+}
@@ -1,6 +1,195 @@
 #include "driver_facade.hpp"
+#include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <thread>
+#include <vector>
+
+/**
+ * @brief Transfer a buffer over SPI in full duplex.
+ *
+ * Generic fallback built on the byte-level transfer().
+ *
+ * @param tx Bytes to send, or nullptr to send 0x00
+ * @param rx Buffer for received bytes, or nullptr to discard them
+ * @param length Number of bytes to transfer
+ */
+void i_chip_spi_api::transfer(const uint8_t *tx, uint8_t *rx,
+                              std::size_t length) {
+  for (std::size_t i = 0; i < length; ++i) {
+    uint8_t data = transfer(tx ? tx[i] : 0x00);
+    if (rx)
+      rx[i] = data;
+  }
+}
+
+/**
+ * @brief Receive a buffer on several data lines at once.
+ *
+ * Generic fallback for single-line buses: the dummy cycles are
+ * clocked as whole bytes and the data with receive(). The
+ * interface has no way to clock single cycles, so width must be
+ * 1 and dummyCycles a multiple of 8.
+ *
+ * @param rx Buffer for received bytes
+ * @param length Number of bytes to receive
+ * @param width Data lines to use, must be 1 here
+ * @param dummyCycles SCK cycles between address and data, a
+ * multiple of 8
+ */
+void i_chip_spi_api::receiveWide(uint8_t *rx, std::size_t length,
+                                 [[maybe_unused]] unsigned width,
+                                 unsigned dummyCycles) {
+  assert(width == 1 && dummyCycles % 8 == 0);
+  transfer(nullptr, nullptr, dummyCycles / 8);
+  receive(rx, length);
+}
+
+/**
+ * @brief Run a whole transaction: select, transfer, deselect.
+ *
+ * Generic fallback making the three calls in turn.
+ *
+ * @param tx Bytes to send, or nullptr to send 0x00
+ * @param rx Buffer for received bytes, or nullptr to discard them
+ * @param length Number of bytes to transfer
+ */
+void i_chip_spi_api::transaction(const uint8_t *tx, uint8_t *rx,
+                                 std::size_t length) {
+  select();
+  transfer(tx, rx, length);
+  deselect();
+}
+
+/**
+ * @brief Replace the masked bits of a byte in one read-modify-write.
+ *
+ * Generic fallback built on readByte() and writeByte().
+ *
+ * @param address Memory address
+ * @param mask Bits to update
+ * @param values New values for the masked bits
+ */
+template <class Address>
+void basic_memory_device_api<Address>::updateBits(Address address,
+                                                  uint8_t mask,
+                                                  uint8_t values) {
+  uint8_t original = readByte(address);
+  uint8_t byte = (original & ~mask) | (values & mask);
+  if (byte != original)
+    writeByte(address, byte);
+}
+
+/**
+ * @brief Apply a batch of bit assignments.
+ *
+ * Generic fallback issuing one updateBits() per entry.
+ *
+ * @param updates Pointer to bit assignments
+ * @param count Number of bit assignments
+ */
+template <class Address>
+void basic_memory_device_api<Address>::updateBits(
+    const basic_bit_update<Address> *updates, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    updateBits(updates[i].address, 1 << updates[i].bitPosition,
+               updates[i].value ? 0xFF : 0x00);
+  }
+}
+
+template class basic_memory_device_api<uint16_t>;
+template class basic_memory_device_api<uint32_t>;
+
+/**
+ * @brief Set every pin in the mask high.
+ *
+ * Generic fallback issuing one setHigh() per pin.
+ *
+ * @param mask Pin mask, bit n selects pin n
+ */
+void i_chip_gpio_driver::setMask(uint32_t mask) {
+  for (int pin = 0; mask; ++pin, mask >>= 1) {
+    if (mask & 0x1)
+      setHigh(pin);
+  }
+}
+
+/**
+ * @brief Set every pin in the mask low.
+ *
+ * Generic fallback issuing one setLow() per pin.
+ *
+ * @param mask Pin mask, bit n selects pin n
+ */
+void i_chip_gpio_driver::clearMask(uint32_t mask) {
+  for (int pin = 0; mask; ++pin, mask >>= 1) {
+    if (mask & 0x1)
+      setLow(pin);
+  }
+}
+
+/**
+ * @brief Drive the masked pins to the given levels.
+ *
+ * Generic fallback issuing one setHigh()/setLow() per pin.
+ *
+ * @param mask Pin mask, bit n selects pin n
+ * @param values Levels for the masked pins
+ */
+void i_chip_gpio_driver::writePort(uint32_t mask, uint32_t values) {
+  for (int pin = 0; mask; ++pin, mask >>= 1, values >>= 1) {
+    if (!(mask & 0x1))
+      continue;
+    if (values & 0x1)
+      setHigh(pin);
+    else
+      setLow(pin);
+  }
+}
+
+/**
+ * @brief Read the levels of every pin in a mask.
+ *
+ * Generic fallback issuing one read() per pin.
+ *
+ * @param mask Pin mask, bit n selects pin n
+ * @return uint32_t Levels, bit n for pin n, zero outside mask
+ */
+uint32_t i_chip_gpio_driver::readMask(uint32_t mask) {
+  uint32_t levels = 0;
+  for (int pin = 0; mask; ++pin, mask >>= 1) {
+    if ((mask & 0x1) && read(pin))
+      levels |= uint32_t{1} << pin;
+  }
+  return levels;
+}
+
+/**
+ * @brief Play a precompiled waveform in one call.
+ *
+ * Generic fallback issuing one writePort() per edge and one
+ * readMask() per sample, so drivers without port access still
+ * end up in per-pin operations.
+ *
+ * @param edges Edge list, see spi_waveform
+ * @param count Number of edges
+ * @param sampleMask Input pins to sample
+ * @param rxOut Buffer for one byte per 8 samples, or nullptr to
+ * skip sampling
+ */
+void i_chip_gpio_driver::submit(const gpio_edge *edges, std::size_t count,
+                                uint32_t sampleMask, uint8_t *rxOut) {
+  std::size_t bit = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    writePort(edges[i].mask, edges[i].values);
+    if (!edges[i].sample || !rxOut)
+      continue;
+
+    uint8_t &byte = rxOut[bit / 8];
+    byte = static_cast<uint8_t>((byte << 1) | (readMask(sampleMask) ? 1 : 0));
+    ++bit;
+  }
+}
 
 /**
  * @brief Construct a chip_spi_api object for bit-banging SPI.
@@ -10,96 +199,244 @@
  * @param pinSCK SPI clock pin
  * @param pinMOSI SPI MOSI pin
  * @param pinMISO SPI MISO pin
+ * @param timing Delay policy between SCK edges
  */
 chip_spi_api::chip_spi_api(i_chip_gpio_driver &gpio, int pinCS, int pinSCK,
-                           int pinMOSI, int pinMISO)
-    : m_gpio(gpio), pinCS_(pinCS), pinSCK_(pinSCK), pinMOSI_(pinMOSI),
-      pinMISO_(pinMISO) {
-  deselect();
-  m_gpio.setLow(pinSCK_);
+                           int pinMOSI, int pinMISO, spi_timing timing)
+    : gpio_(gpio), io_{pinMOSI, pinMISO, -1, -1},
+      waveform_(pinCS, pinSCK, pinMOSI),
+      maskMISO_(uint32_t{1} << (pinMISO & 31)),
+      spi_(gpio, spi_pin_map{pinCS, pinSCK, pinMOSI, pinMISO}, timing) {
+  // a waveform carries no delays, so it only stands in for the
+  // bit loop when the bus runs as fast as the GPIO driver
+  useWaveform_ = timing.delayMode() == spi_timing::mode::none &&
+                 spi_waveform::fits(pinCS) && spi_waveform::fits(pinSCK) &&
+                 spi_waveform::fits(pinMOSI) && spi_waveform::fits(pinMISO);
+
+  gpio_.setDirection(pinMOSI, true);
+  gpio_.setDirection(pinMISO, false);
+}
+
+/**
+ * @brief Configure the number of data lines for wide reads.
+ *
+ * @param lines 1, 2 or 4
+ * @param pinIO2 IO2 pin, used with 4 lines
+ * @param pinIO3 IO3 pin, used with 4 lines
+ */
+void chip_spi_api::setDataLines(unsigned lines, int pinIO2, int pinIO3) {
+  lines_ = lines >= 4 ? 4 : lines >= 2 ? 2 : 1;
+  if (lines_ < 4)
+    return;
+
+  io_[2] = pinIO2;
+  io_[3] = pinIO3;
+  // /WP and /HOLD inactive while the lines are not in use
+  for (int pin : {pinIO2, pinIO3}) {
+    gpio_.setDirection(pin, true);
+    gpio_.setHigh(pin);
+  }
 }
 
 /**
  * @brief Select the SPI device by pulling CS low.
  */
-void chip_spi_api::select() { m_gpio.setLow(pinCS_); }
+void chip_spi_api::select() { spi_.select(); }
 
 /**
  * @brief Deselect the SPI device by pulling CS high.
+ *
+ * Ends a wide read, so the data lines are driven again.
  */
-void chip_spi_api::deselect() { m_gpio.setHigh(pinCS_); }
+void chip_spi_api::deselect() {
+  spi_.deselect();
+  if (turnedAround_)
+    restoreLines();
+}
 
 /**
- * @brief Generate a single clock pulse on the SCK line.
+ * @brief Receive a buffer on several data lines at once.
+ *
+ * The master releases the lines it drives before the dummy
+ * cycles, so the device can take them over on the falling
+ * edge that follows without contention. A single line, or more
+ * lines than are wired, reads on MISO after exactly dummyCycles
+ * cycles.
  *
- * This function is used by writeBit and readBit.
+ * @param rx Buffer for received bytes
+ * @param length Number of bytes to receive
+ * @param width Data lines to use, at most dataLines()
+ * @param dummyCycles SCK cycles between address and data
  */
-void chip_spi_api::clockPulse() {
-  m_gpio.setHigh(pinSCK_);
+void chip_spi_api::receiveWide(uint8_t *rx, std::size_t length,
+                               unsigned width, unsigned dummyCycles) {
+  if (width <= 1 || width > lines_) {
+    spi_.clockCycles(dummyCycles);
+    receive(rx, length);
+    return;
+  }
 
-  std::this_thread::sleep_for(std::chrono::microseconds(1));
+  gpio_.setDirection(io_[0], false);
+  if (width == 4) {
+    gpio_.setDirection(io_[2], false);
+    gpio_.setDirection(io_[3], false);
+  }
+  turnedAround_ = true;
 
-  m_gpio.setLow(pinSCK_);
+  spi_.clockCycles(dummyCycles);
+  spi_.receiveLines(io_, width, rx, length);
+}
 
-  std::this_thread::sleep_for(std::chrono::microseconds(1));
+/**
+ * @brief Drive the data lines again after a wide read.
+ */
+void chip_spi_api::restoreLines() {
+  gpio_.setDirection(io_[0], true);
+  if (lines_ == 4) {
+    for (int pin : {io_[2], io_[3]}) {
+      gpio_.setDirection(pin, true);
+      gpio_.setHigh(pin);
+    }
+  }
+  turnedAround_ = false;
 }
 
 /**
- * @brief Write a single bit over SPI.
+ * @brief Transfer a byte over SPI.
+ *
+ * Sends 8 bits MSB-first and returns the byte received simultaneously.
  *
- * @param bit Value of the bit to write (true = 1, false = 0)
+ * @param data Byte to send
+ * @return uint8_t Received byte
  */
-void chip_spi_api::writeBit(bool bit) {
-  if (bit)
-    m_gpio.setHigh(pinMOSI_);
-  else
-    m_gpio.setLow(pinMOSI_);
-  clockPulse();
-}
+uint8_t chip_spi_api::transfer(uint8_t data) { return spi_.transfer(data); }
 
 /**
- * @brief Read a single bit over SPI.
+ * @brief Transfer a buffer over SPI in full duplex.
+ *
+ * Runs the bit loop for the whole buffer without
+ * going back through the virtual interface per byte.
  *
- * @return true if the bit read is 1, false if 0
+ * @param tx Bytes to send, or nullptr to send 0x00
+ * @param rx Buffer for received bytes, or nullptr to discard them
+ * @param length Number of bytes to transfer
  */
-bool chip_spi_api::readBit() {
-  clockPulse();
-  return m_gpio.read(pinMISO_);
+void chip_spi_api::transfer(const uint8_t *tx, uint8_t *rx,
+                            std::size_t length) {
+  spi_.transfer(tx, rx, length);
 }
 
 /**
- * @brief Transfer a byte over SPI.
+ * @brief Run a whole transaction as one precompiled waveform.
  *
- * Sends 8 bits MSB-first and returns the byte received simultaneously.
+ * The transaction is compiled into an edge list and handed to
+ * the GPIO driver in a single submit() call. With a delay policy
+ * or while a wide read holds the lines, the engine clocks the
+ * transaction bit by bit instead.
  *
- * @param data Byte to send
- * @return uint8_t Received byte
+ * @param tx Bytes to send, or nullptr to send 0x00
+ * @param rx Buffer for received bytes, or nullptr to discard them
+ * @param length Number of bytes to transfer
  */
-uint8_t chip_spi_api::transfer(uint8_t data) {
-  uint8_t result = 0;
-  for (int i = 7; i >= 0; --i) {
-    bool bitToSend = (data >> i) & 0x1;
-    writeBit(bitToSend);
-    bool bitReceived = m_gpio.read(pinMISO_);
-    result = (result << 1) | (bitReceived ? 1 : 0);
+void chip_spi_api::transaction(const uint8_t *tx, uint8_t *rx,
+                               std::size_t length) {
+  if (!useWaveform_ || turnedAround_) {
+    i_chip_spi_api::transaction(tx, rx, length);
+    return;
   }
-  return result;
+
+  waveform_.compile(tx, length);
+  gpio_.submit(waveform_.data(), waveform_.size(), maskMISO_, rx);
+
+  spi_.counters().onTransaction();
+  spi_.counters().onBytes(length);
+  spi_.counters().onGpio(gpio_.hasPortAccess() ? waveform_.size()
+                                               : waveform_.pinWrites());
 }
 
 /**
- * @brief Construct an eeprom_api object for EEPROM operations.
+ * @brief Construct an EEPROM driver object for EEPROM operations.
  *
  * @param spi Reference to SPI interface
  */
-eeprom_api::eeprom_api(i_chip_spi_api &spi) : spi_api_(spi) {}
+template <class Chip>
+basic_eeprom_api<Chip>::basic_eeprom_api(i_chip_spi_api &spi)
+    : spi_api_(spi) {}
 
 /**
- * @brief Enable writing to EEPROM.
+ * @brief Destroy the EEPROM driver object.
+ *
+ * Releases CS if a read is open and lets a deferred write cycle
+ * finish, so the next user of the bus finds the chip ready.
  */
-void eeprom_api::writeEnable() {
-  spi_api_.select();
-  spi_api_.transfer(CMD_WREN);
+template <class Chip>
+basic_eeprom_api<Chip>::~basic_eeprom_api() {
+  endSequentialRead();
+  ensureReady();
+}
+
+/**
+ * @brief Terminate the sequential read left open by the read API.
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::endSequentialRead() {
+  if (!readOpen_)
+    return;
+
   spi_api_.deselect();
+  readOpen_ = false;
+}
+
+/**
+ * @brief Position the sequential read stream at the given address.
+ *
+ * The EEPROM keeps shifting out the next byte for as long as CS
+ * stays low, rolling over from the last address to 0x000, so
+ * neighbouring reads only pay for their payload. A stream whose
+ * CS was raised by another chip on a shared bus is reopened.
+ *
+ * @param address Memory address of the next byte to read
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::beginSequentialRead(address_type address) {
+  address %= MEMORY_SIZE;
+  if (readOpen_ && readNext_ == address && !spi_api_.preempted())
+    return;
+
+  endSequentialRead();
+  ensureReady();
+
+  uint8_t header[HEADER_SIZE];
+  buildHeader(CMD_READ, address, header);
+
+  spi_api_.select();
+  spi_api_.send(header, HEADER_SIZE);
+
+  readOpen_ = true;
+  readNext_ = address;
+}
+
+/**
+ * @brief Clock the next byte out of the open READ transaction.
+ *
+ * @return uint8_t Byte at the current stream address
+ */
+template <class Chip>
+uint8_t basic_eeprom_api<Chip>::readNext() {
+  uint8_t data = spi_api_.transfer(0x00);
+  readNext_ = (readNext_ + 1) % MEMORY_SIZE;
+  return data;
+}
+
+/**
+ * @brief Enable writing to EEPROM.
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::writeEnable() {
+  endSequentialRead();
+  ensureReady();
+
+  spi_api_.transaction(&CMD_WREN, nullptr, 1);
 }
 
 /**
@@ -107,9 +444,12 @@ void eeprom_api::writeEnable() {
  *
  * @return uint8_t Status register value
  */
-uint8_t eeprom_api::readStatus() {
-  spi_api_.select();
-  spi_api_.transfer(CMD_RDSR);
+template <class Chip>
+uint8_t basic_eeprom_api<Chip>::readStatus() {
+  endSequentialRead();
+
+  const uint8_t tx[2] = {CMD_RDSR, 0x00};
+  uint8_t rx[2];
   /*
    * it's seems weird but we have to
    * make a second call with zeroed
@@ -121,51 +461,125 @@ uint8_t eeprom_api::readStatus() {
    * real response to prevoiusly
    * send command
    * */
-  uint8_t status = spi_api_.transfer(0x00);
-  spi_api_.deselect();
-  return status;
+  spi_api_.transaction(tx, rx, sizeof(tx));
+  return rx[1];
 }
 
 /**
  * @brief Wait until EEPROM is ready for the next operation.
  *
  * Polls the Write-In-Process (WIP) bit in the status register.
+ * If the first poll finds the chip busy, sleeps until the learned
+ * typical end of the write cycle and then polls with exponential
+ * back-off, capped at a fraction of tWC.
+ *
+ * The cycle ended between the last busy poll and the first ready
+ * one, so the estimate learns from the middle of that bracket,
+ * not from the wake-up time. When the first poll after the sleep
+ * already finds the chip ready, the bracket starts at the poll
+ * before the sleep and pulls the estimate down.
  */
-void eeprom_api::waitUntilReady() {
+template <class Chip>
+void basic_eeprom_api<Chip>::waitUntilReady() {
   /*
    * it's recommended to organize
    * pooling cycle in docs itself with
    * pooling wip (write-in-process) bit status in the first place
    * to be able to have consistent memory write
    * */
+  using clock = std::chrono::steady_clock;
+  auto begin = clock::now();
+  ++readyStats_.waits;
+
   uint8_t wip_bit = 0x01;
-  while (readStatus() & wip_bit) {
-    std::this_thread::sleep_for(std::chrono::microseconds(10));
+  auto isReady = [&] {
+    ++readyStats_.polls;
+    return (readStatus() & wip_bit) == 0;
+  };
+
+  if (!isReady()) {
+    auto lastBusy = begin;
+    std::this_thread::sleep_until(writeStart_ + cycleEstimate_);
+
+    std::chrono::nanoseconds interval = POLL_INTERVAL;
+    auto polled = clock::now();
+    while (!isReady()) {
+      lastBusy = polled;
+      std::this_thread::sleep_for(interval);
+      interval = std::min<std::chrono::nanoseconds>(interval * 2,
+                                                    WRITE_CYCLE_TIME / 8);
+      polled = clock::now();
+    }
+
+    std::chrono::nanoseconds observed =
+        (lastBusy - writeStart_) + (polled - lastBusy) / 2;
+    cycleEstimate_ = std::min<std::chrono::nanoseconds>(
+        (3 * cycleEstimate_ + observed) / 4, WRITE_CYCLE_TIME);
   }
+
+  std::chrono::nanoseconds waited = clock::now() - begin;
+  readyStats_.waited += waited;
 }
 
 /**
- * @brief Send a raw command byte to EEPROM.
+ * @brief Wait for the write cycle left pending by deferred mode.
  *
- * @param command Command to send
+ * The time since the write was clocked out, up to tWC, is
+ * accounted as hidden: the caller used it for other work.
  */
-void eeprom_api::sendCommand(uint8_t command) { spi_api_.transfer(command); }
+template <class Chip>
+void basic_eeprom_api<Chip>::ensureReady() {
+  if (!writePending_)
+    return;
+  writePending_ = false;
+
+  std::chrono::nanoseconds elapsed =
+      std::chrono::steady_clock::now() - writeStart_;
+  readyStats_.hidden +=
+      std::min<std::chrono::nanoseconds>(elapsed, WRITE_CYCLE_TIME);
+
+  waitUntilReady();
+}
 
 /**
- * @brief Send a 9-bit EEPROM memory address over SPI.
+ * @brief Enable or disable the deferred ready-wait mode.
  *
- * @param address Memory address (0..511)
+ * @param enable true to defer the ready-wait
  */
-void eeprom_api::sendAddress(uint16_t address) {
-  /*
-   * from the docs:
-   * 9-bit address
-   * 512 byte memory in total
-   * */
-  uint8_t addrHigh = (address >> 8) & 0x01;
-  uint8_t addrLow = address & 0xFF;
-  spi_api_.transfer(addrHigh);
-  spi_api_.transfer(addrLow);
+template <class Chip>
+void basic_eeprom_api<Chip>::setDeferredReady(bool enable) {
+  deferredReady_ = enable;
+  if (!deferredReady_) {
+    endSequentialRead();
+    ensureReady();
+  }
+}
+
+/**
+ * @brief Wait for a deferred write cycle to finish, if one is pending.
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::sync() {
+  endSequentialRead();
+  ensureReady();
+}
+
+/**
+ * @brief Encode a command and its address into a header.
+ *
+ * The encoding is the chip's: the 25LC040A carries A8 in bit 3
+ * of the instruction and A7..A0 in the next byte, the larger
+ * parts send 2 or 3 address bytes MSB first.
+ *
+ * @param command Command opcode
+ * @param address Memory address, below MEMORY_SIZE
+ * @param header Output buffer of at least HEADER_SIZE bytes
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::buildHeader(uint8_t command,
+                                         address_type address,
+                                         uint8_t *header) {
+  Chip::encodeHeader(command, address, header);
 }
 
 /**
@@ -174,81 +588,263 @@ void eeprom_api::sendAddress(uint16_t address) {
  * @param address Memory address to write to
  * @param data Byte to write
  */
-void eeprom_api::writeByte(uint16_t address, uint8_t data) {
-  writeEnable();
-
-  spi_api_.select();
-  sendCommand(CMD_WRITE);
-  sendAddress(address);
-  spi_api_.transfer(data);
-  spi_api_.deselect();
-
-  waitUntilReady();
+template <class Chip>
+void basic_eeprom_api<Chip>::writeByte(address_type address, uint8_t data) {
+  call_scope scope(*this, eeprom_call::writeByte);
+  updatePage(address % MEMORY_SIZE, &data, 1);
 }
 
 /**
  * @brief Read a single byte from EEPROM.
  *
+ * Continues the open READ transaction when the previous read
+ * ended right before this address.
+ *
  * @param address Memory address to read
  * @return uint8_t Value read from memory
  */
-uint8_t eeprom_api::readByte(uint16_t address) {
-  spi_api_.select();
-  sendCommand(CMD_READ);
-  sendAddress(address);
-  uint8_t data = spi_api_.transfer(0x00);
-  spi_api_.deselect();
-  return data;
+template <class Chip>
+uint8_t basic_eeprom_api<Chip>::readByte(address_type address) {
+  call_scope scope(*this, eeprom_call::readByte);
+  beginSequentialRead(address);
+  return readNext();
+}
+
+/**
+ * @brief Program up to one page with a single WRITE transaction.
+ *
+ * The EEPROM latches every byte clocked in after the address into
+ * its page buffer and starts one internal write cycle on deselect,
+ * so a whole page costs the same as a single byte. Header and
+ * payload go out as one contiguous buffer.
+ *
+ * @param address Memory address of the first byte
+ * @param data Pointer to data buffer
+ * @param length Number of bytes, must not cross a page boundary
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::writePage(address_type address,
+                                       const uint8_t *data,
+                                       std::size_t length) {
+  writeEnable();
+
+  uint8_t frame[HEADER_SIZE + PAGE_SIZE];
+  buildHeader(CMD_WRITE, address, frame);
+  std::copy(data, data + length, frame + HEADER_SIZE);
+
+  spi_api_.transaction(frame, nullptr, HEADER_SIZE + length);
+
+  writeStart_ = std::chrono::steady_clock::now();
+  ++writeStats_.writeCycles;
+  writeStats_.bytesProgrammed += length;
+
+  if (deferredReady_)
+    writePending_ = true;
+  else
+    waitUntilReady();
+}
+
+/**
+ * @brief Update up to one page, honouring the skip-unchanged mode.
+ *
+ * In skip-unchanged mode the current contents are fetched with
+ * one sequential read and only the span between the first and
+ * the last differing byte is programmed.
+ *
+ * @param address Memory address of the first byte
+ * @param data Pointer to data buffer
+ * @param length Number of bytes, must not cross a page boundary
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::updatePage(address_type address,
+                                        const uint8_t *data,
+                                        std::size_t length) {
+  if (!skipUnchanged_) {
+    writePage(address, data, length);
+    return;
+  }
+
+  uint8_t current[PAGE_SIZE];
+  readBuffer(address, current, length);
+  writeChanged(address, current, data, length);
+}
+
+/**
+ * @brief Program a page span whose current contents are known.
+ *
+ * In skip-unchanged mode only the span between the first and
+ * the last differing byte is programmed, and nothing at all if
+ * the contents already match. Otherwise the whole span is written.
+ *
+ * @param address Memory address of the first byte
+ * @param current Bytes currently stored in the span
+ * @param data New bytes for the span
+ * @param length Number of bytes, must not cross a page boundary
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::writeChanged(address_type address,
+                                          const uint8_t *current,
+                                          const uint8_t *data,
+                                          std::size_t length) {
+  if (!skipUnchanged_) {
+    writePage(address, data, length);
+    return;
+  }
+
+  std::size_t first = 0;
+  while (first < length && current[first] == data[first])
+    ++first;
+
+  if (first == length) {
+    ++writeStats_.skippedCycles;
+    return;
+  }
+
+  std::size_t last = length - 1;
+  while (current[last] == data[last])
+    --last;
+
+  writePage(address + first, data + first, last - first + 1);
 }
 
 /**
  * @brief Write multiple bytes to EEPROM.
  *
- * Writes each byte individually using writeByte().
+ * Splits the range on page boundaries and programs each
+ * chunk with updatePage(). Bytes past a page boundary
+ * would otherwise wrap around to the start of the same page.
  *
  * @param address Starting memory address
  * @param data Pointer to data buffer
  * @param length Number of bytes to write
  */
-void eeprom_api::writeBuffer(uint16_t address, const uint8_t *data,
-                             std::size_t length) {
-  for (std::size_t i = 0; i < length; ++i) {
-    writeByte(address + i, data[i]);
+template <class Chip>
+void basic_eeprom_api<Chip>::writeBuffer(address_type address,
+                                         const uint8_t *data,
+                                         std::size_t length) {
+  call_scope scope(*this, eeprom_call::writeBuffer);
+  while (length > 0) {
+    address %= MEMORY_SIZE;
+    std::size_t chunk =
+        std::min(length, PAGE_SIZE - (address % PAGE_SIZE));
+
+    updatePage(address, data, chunk);
+
+    address += chunk;
+    data += chunk;
+    length -= chunk;
   }
 }
 
 /**
  * @brief Read multiple bytes from EEPROM.
  *
- * Reads each byte individually using readByte().
+ * Clocks the whole range out of a single READ transaction,
+ * wrapping from the end of the array to address 0x000.
  *
  * @param address Starting memory address
  * @param buffer Pointer to buffer to store data
  * @param length Number of bytes to read
  */
-void eeprom_api::readBuffer(uint16_t address, uint8_t *buffer,
-                            std::size_t length) {
-  for (std::size_t i = 0; i < length; ++i) {
-    buffer[i] = readByte(address + i);
-  }
+template <class Chip>
+void basic_eeprom_api<Chip>::readBuffer(address_type address,
+                                        uint8_t *buffer, std::size_t length) {
+  call_scope scope(*this, eeprom_call::readBuffer);
+  if (length == 0)
+    return;
+
+  beginSequentialRead(address);
+  spi_api_.receive(buffer, length);
+  readNext_ = (readNext_ + length) % MEMORY_SIZE;
 }
 
 /**
  * @brief Write a single bit to EEPROM.
  *
- * Uses read-modify-write on the containing byte.
+ * Uses read-modify-write on the containing byte, see updateBits().
  *
  * @param address Memory address
  * @param bitPosition Bit index (0-7)
  * @param value Boolean value to write
  */
-void eeprom_api::writeBit(uint16_t address, uint8_t bitPosition, bool value) {
-  uint8_t byte = readByte(address);
-  if (value)
-    byte |= (1 << bitPosition);
-  else
-    byte &= ~(1 << bitPosition);
-  writeByte(address, byte);
+template <class Chip>
+void basic_eeprom_api<Chip>::writeBit(address_type address,
+                                      uint8_t bitPosition, bool value) {
+  call_scope scope(*this, eeprom_call::writeBit);
+  updateBits(address, 1 << bitPosition, value ? 0xFF : 0x00);
+}
+
+/**
+ * @brief Replace the masked bits of a byte in one read-modify-write.
+ *
+ * In skip-unchanged mode the byte already read is the comparison,
+ * so bits that hold their values already cost no write cycle.
+ *
+ * @param address Memory address
+ * @param mask Bits to update
+ * @param values New values for the masked bits
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::updateBits(address_type address, uint8_t mask,
+                                        uint8_t values) {
+  call_scope scope(*this, eeprom_call::updateBits);
+  address %= MEMORY_SIZE;
+
+  uint8_t original = readByte(address);
+  uint8_t byte = (original & ~mask) | (values & mask);
+  writeChanged(address, &original, &byte, 1);
+}
+
+/**
+ * @brief Apply a batch of bit assignments with one write per page.
+ *
+ * Updates are grouped by page. For each page the span between
+ * the lowest and the highest touched address is read once,
+ * patched in RAM and programmed with a single write cycle.
+ *
+ * @param updates Pointer to bit assignments
+ * @param count Number of bit assignments
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::updateBits(const bit_update_type *updates,
+                                        std::size_t count) {
+  call_scope scope(*this, eeprom_call::updateBits);
+  std::vector<bit_update_type> sorted(updates, updates + count);
+  for (auto &update : sorted)
+    update.address %= MEMORY_SIZE;
+
+  // stable: the last assignment to a bit keeps winning
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const bit_update_type &a, const bit_update_type &b) {
+                     return a.address < b.address;
+                   });
+
+  std::size_t i = 0;
+  while (i < sorted.size()) {
+    address_type first = sorted[i].address;
+    address_type page = first - first % PAGE_SIZE;
+
+    std::size_t end = i;
+    while (end < sorted.size() && sorted[end].address < page + PAGE_SIZE)
+      ++end;
+    address_type last = sorted[end - 1].address;
+    std::size_t length = last - first + 1;
+
+    uint8_t current[PAGE_SIZE];
+    uint8_t data[PAGE_SIZE];
+    readBuffer(first, current, length);
+    std::copy(current, current + length, data);
+
+    for (; i < end; ++i) {
+      uint8_t &byte = data[sorted[i].address - first];
+      if (sorted[i].value)
+        byte |= (1 << sorted[i].bitPosition);
+      else
+        byte &= ~(1 << sorted[i].bitPosition);
+    }
+
+    writeChanged(first, current, data, length);
+  }
 }
 
 /**
@@ -258,7 +854,78 @@ void eeprom_api::writeBit(uint16_t address, uint8_t bitPosition, bool value) {
  * @param bitPosition Bit index (0-7)
  * @return true if bit is 1, false if 0
  */
-bool eeprom_api::readBit(uint16_t address, uint8_t bitPosition) {
+template <class Chip>
+bool basic_eeprom_api<Chip>::readBit(address_type address,
+                                     uint8_t bitPosition) {
+  call_scope scope(*this, eeprom_call::readBit);
   uint8_t byte = readByte(address);
   return (byte >> bitPosition) & 0x01;
 }
+
+/**
+ * @brief Get the call latency histograms.
+ *
+ * Status polls and ready-wait time are kept once, in readyStats();
+ * mirroring them here would only double the bookkeeping per poll.
+ *
+ * @return eeprom_telemetry Snapshot of the histograms
+ */
+template <class Chip>
+eeprom_telemetry basic_eeprom_api<Chip>::telemetry() const {
+  eeprom_telemetry result;
+#if DRIVER_FACADE_TELEMETRY
+  for (std::size_t i = 0; i < latency_.size(); ++i)
+    result.latency[i] = latency_[i].snapshot();
+#endif
+  return result;
+}
+
+/**
+ * @brief Reset the call latency histograms.
+ */
+template <class Chip>
+void basic_eeprom_api<Chip>::resetTelemetry() {
+#if DRIVER_FACADE_TELEMETRY
+  for (auto &histogram : latency_)
+    histogram.reset();
+#endif
+}
+
+#if DRIVER_FACADE_TELEMETRY
+/**
+ * @brief Start timing a public call.
+ *
+ * @param api Instance being timed
+ * @param call Histogram to record into
+ */
+template <class Chip>
+basic_eeprom_api<Chip>::call_scope::call_scope(basic_eeprom_api &api,
+                                               eeprom_call call)
+    : api_(api), call_(call), outer_(api.callDepth_++ == 0) {
+  if (outer_)
+    begin_ = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Record the call latency if this is the outermost call.
+ */
+template <class Chip>
+basic_eeprom_api<Chip>::call_scope::~call_scope() {
+  --api_.callDepth_;
+  if (outer_)
+    api_.latency_[static_cast<std::size_t>(call_)].record(
+        std::chrono::steady_clock::now() - begin_);
+}
+#endif
+
+template class basic_eeprom_api<eeprom_25lc010a>;
+template class basic_eeprom_api<eeprom_25lc020a>;
+template class basic_eeprom_api<eeprom_25lc040a>;
+template class basic_eeprom_api<eeprom_25lc080c>;
+template class basic_eeprom_api<eeprom_25lc160c>;
+template class basic_eeprom_api<eeprom_25lc320a>;
+template class basic_eeprom_api<eeprom_25lc640a>;
+template class basic_eeprom_api<eeprom_25lc128>;
+template class basic_eeprom_api<eeprom_25lc256>;
+template class basic_eeprom_api<eeprom_25lc512>;
+template class basic_eeprom_api<eeprom_25lc1024>;
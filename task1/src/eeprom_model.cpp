@@ -0,0 +1,233 @@
+#include "eeprom_model.hpp"
+#include <algorithm>
+
+/**
+ * @brief Construct a model filled with 0xFF, the erased state.
+ *
+ * @param config Geometry, timing and wiring
+ */
+eeprom_model::eeprom_model(eeprom_model_config config)
+    : spi_device_model(config.pins, config.portAccess), config_(config),
+      memory_(config.capacity, 0xFF), pageBuffer_(config.pageSize),
+      pageLatched_(config.pageSize) {}
+
+/**
+ * @brief Get the status register as RDSR would return it.
+ *
+ * @return uint8_t Status register value
+ */
+uint8_t eeprom_model::status() {
+  updateBusy();
+  return (writing_ ? STATUS_WIP : 0) | (wel_ ? STATUS_WEL : 0) |
+         blockProtect_;
+}
+
+/**
+ * @brief Tell whether a write cycle is in progress.
+ *
+ * @return true while WIP is set
+ */
+bool eeprom_model::busy() {
+  updateBusy();
+  return writing_;
+}
+
+/**
+ * @brief Reset the pin and write cycle counters.
+ */
+void eeprom_model::resetCounters() {
+  spi_device_model::resetCounters();
+  writeCycles_ = 0;
+}
+
+/**
+ * @brief Start a new transaction on the CS falling edge.
+ */
+void eeprom_model::onSelect() {
+  phase_ = phase::command;
+  opcode_ = 0;
+  wrsrReceived_ = false;
+}
+
+/**
+ * @brief Finish the transaction on the CS rising edge.
+ *
+ * Writes only start when CS rises on a byte boundary with the
+ * latch set; anything else aborts the instruction.
+ *
+ * @param aligned CS rose on a byte boundary
+ */
+void eeprom_model::onDeselect(bool aligned) {
+  bool latched =
+      std::find(pageLatched_.begin(), pageLatched_.end(), true) !=
+      pageLatched_.end();
+
+  switch (opcode_) {
+  case CMD_WREN:
+    wel_ = true;
+    break;
+  case CMD_WRDI:
+    wel_ = false;
+    break;
+  case CMD_WRITE:
+    if (!wel_ || !aligned || !latched || pageProtected())
+      break;
+    for (std::size_t i = 0; i < config_.pageSize; ++i)
+      if (pageLatched_[i])
+        memory_[pageBase_ + i] = pageBuffer_[i];
+    startWriteCycle();
+    break;
+  case CMD_WRSR:
+    if (!wel_ || !aligned || !wrsrReceived_)
+      break;
+    blockProtect_ = newStatus_ & STATUS_BP;
+    startWriteCycle();
+    break;
+  default:
+    break;
+  }
+  opcode_ = 0;
+}
+
+/**
+ * @brief Supply the next byte of an output stream.
+ *
+ * READ moves on to the next address, rolling over at the end
+ * of memory, and RDSR repeats the status register.
+ *
+ * @return uint8_t Next output byte
+ */
+uint8_t eeprom_model::nextOutput() {
+  if (phase_ == phase::read) {
+    address_ = (address_ + 1) % config_.capacity;
+    return memory_[address_];
+  }
+  return status();
+}
+
+/**
+ * @brief Handle a fully received byte.
+ *
+ * @param byte Received byte
+ */
+void eeprom_model::onByte(uint8_t byte) {
+  switch (phase_) {
+  case phase::command: {
+    phase_ = phase::ignore;
+    updateBusy();
+
+    uint8_t command = byte;
+    std::size_t high = 0;
+    if (config_.a8InOpcode) {
+      command = byte & ~0x08;
+      high = (byte >> 3) & 0x01;
+    }
+
+    // only RDSR gets through while a write cycle runs
+    if (writing_ && byte != CMD_RDSR)
+      return;
+
+    if (command == CMD_READ || command == CMD_WRITE) {
+      opcode_ = command;
+      address_ = high;
+      addressLeft_ = config_.addressBytes;
+      std::fill(pageLatched_.begin(), pageLatched_.end(), false);
+      phase_ = phase::address;
+    } else if (byte == CMD_RDSR) {
+      opcode_ = byte;
+      startOutput(status());
+      phase_ = phase::status;
+    } else if (byte == CMD_WRSR) {
+      opcode_ = byte;
+      phase_ = phase::wrsr;
+    } else if (byte == CMD_WREN || byte == CMD_WRDI) {
+      opcode_ = byte;
+    }
+    break;
+  }
+  case phase::address:
+    address_ = (address_ << 8) | byte;
+    if (--addressLeft_ > 0)
+      break;
+    address_ %= config_.capacity;
+    if (opcode_ == CMD_READ) {
+      startOutput(memory_[address_]);
+      phase_ = phase::read;
+    } else {
+      pageBase_ = address_ - address_ % config_.pageSize;
+      phase_ = phase::write;
+    }
+    break;
+  case phase::write: {
+    std::size_t offset = address_ - pageBase_;
+    pageBuffer_[offset] = byte;
+    pageLatched_[offset] = true;
+    address_ = pageBase_ + (offset + 1) % config_.pageSize;
+    break;
+  }
+  case phase::wrsr:
+    newStatus_ = byte;
+    wrsrReceived_ = true;
+    phase_ = phase::ignore;
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Start an internal write cycle.
+ */
+void eeprom_model::startWriteCycle() {
+  writing_ = true;
+  busyUntil_ = std::chrono::steady_clock::now() + config_.writeCycle;
+  ++writeCycles_;
+}
+
+/**
+ * @brief Retire a finished write cycle.
+ *
+ * WIP and WEL both clear when the cycle ends.
+ */
+void eeprom_model::updateBusy() {
+  if (!writing_ || std::chrono::steady_clock::now() < busyUntil_)
+    return;
+  writing_ = false;
+  wel_ = false;
+}
+
+/**
+ * @brief Tell whether block protection covers an address.
+ *
+ * BP1:BP0 protect the upper quarter, the upper half or all of
+ * the array.
+ *
+ * @param address Memory address
+ * @return true if writes to the address are inhibited
+ */
+bool eeprom_model::isProtected(std::size_t address) const {
+  switch (blockProtect_ >> 2) {
+  case 1:
+    return address >= config_.capacity - config_.capacity / 4;
+  case 2:
+    return address >= config_.capacity / 2;
+  case 3:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Tell whether any latched byte falls into a protected block.
+ *
+ * A WRITE touching protected memory is dropped as a whole.
+ *
+ * @return true if the page write must not start
+ */
+bool eeprom_model::pageProtected() const {
+  for (std::size_t i = 0; i < config_.pageSize; ++i)
+    if (pageLatched_[i] && isProtected(pageBase_ + i))
+      return true;
+  return false;
+}
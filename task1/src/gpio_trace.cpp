@@ -0,0 +1,391 @@
+#include "gpio_trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+/// First bytes of a binary trace file
+static constexpr char TRACE_MAGIC[8] = {'G', 'P', 'I', 'O',
+                                        'T', 'R', 'C', '1'};
+
+/// Size of one event in a trace file
+static constexpr std::size_t TRACE_RECORD = 8 + 4 + 4 + 1;
+
+/**
+ * @brief Construct the ring.
+ *
+ * @param capacity Minimum number of events, rounded up to a
+ * power of two
+ */
+gpio_trace_ring::gpio_trace_ring(std::size_t capacity)
+    : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1),
+      events_(new gpio_trace_event[mask_ + 1]) {}
+
+/**
+ * @brief Take the oldest events, consumer side.
+ *
+ * @param out Buffer for the events
+ * @param max Buffer size in events
+ * @return std::size_t Number of events taken
+ */
+std::size_t gpio_trace_ring::pop(gpio_trace_event *out, std::size_t max) {
+  std::size_t tail = tail_.load(std::memory_order_relaxed);
+  std::size_t head = head_.load(std::memory_order_acquire);
+  std::size_t count = std::min(head - tail, max);
+  for (std::size_t i = 0; i < count; ++i)
+    out[i] = events_[(tail + i) & mask_];
+  tail_.store(tail + count, std::memory_order_release);
+  return count;
+}
+
+/**
+ * @brief Append every pending event to a vector, consumer side.
+ *
+ * @param out Destination
+ * @return std::size_t Number of events taken
+ */
+std::size_t gpio_trace_ring::drain(std::vector<gpio_trace_event> &out) {
+  std::size_t size = out.size();
+  out.resize(size + capacity());
+  std::size_t count = pop(out.data() + size, capacity());
+  out.resize(size + count);
+  return count;
+}
+
+/**
+ * @brief Construct the decorator.
+ *
+ * @param inner Driver doing the pin operations
+ * @param ring Ring receiving the events
+ */
+tracing_gpio_driver::tracing_gpio_driver(i_chip_gpio_driver &inner,
+                                         gpio_trace_ring &ring)
+    : inner_(inner), ring_(ring), start_(std::chrono::steady_clock::now()) {}
+
+/**
+ * @brief Push an event stamped with the current time.
+ *
+ * @param kind Write or read
+ * @param mask Pins involved
+ * @param levels Levels of the masked pins
+ */
+void tracing_gpio_driver::record(gpio_trace_kind kind, uint32_t mask,
+                                 uint32_t levels) {
+  auto now = std::chrono::steady_clock::now() - start_;
+  uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(now)
+                      .count();
+  ring_.push({time, mask, levels & mask, kind});
+}
+
+/**
+ * @brief Mask of a pin, zero if it cannot be traced.
+ *
+ * @param pin Pin number
+ * @return uint32_t Pin mask
+ */
+static uint32_t pinMask(int pin) {
+  return pin >= 0 && pin < 32 ? uint32_t{1} << pin : 0;
+}
+
+/**
+ * @brief Drive a pin high and record it.
+ *
+ * @param pin Pin number
+ */
+void tracing_gpio_driver::setHigh(int pin) {
+  inner_.setHigh(pin);
+  if (uint32_t mask = pinMask(pin))
+    record(gpio_trace_kind::write, mask, mask);
+}
+
+/**
+ * @brief Drive a pin low and record it.
+ *
+ * @param pin Pin number
+ */
+void tracing_gpio_driver::setLow(int pin) {
+  inner_.setLow(pin);
+  if (uint32_t mask = pinMask(pin))
+    record(gpio_trace_kind::write, mask, 0);
+}
+
+/**
+ * @brief Read a pin and record the level.
+ *
+ * @param pin Pin number
+ * @return true if pin is high, false if low
+ */
+bool tracing_gpio_driver::read(int pin) {
+  bool level = inner_.read(pin);
+  if (uint32_t mask = pinMask(pin))
+    record(gpio_trace_kind::read, mask, level ? mask : 0);
+  return level;
+}
+
+/**
+ * @brief Drive every pin in a mask high and record it.
+ *
+ * @param mask Pin mask
+ */
+void tracing_gpio_driver::setMask(uint32_t mask) {
+  inner_.setMask(mask);
+  record(gpio_trace_kind::write, mask, mask);
+}
+
+/**
+ * @brief Drive every pin in a mask low and record it.
+ *
+ * @param mask Pin mask
+ */
+void tracing_gpio_driver::clearMask(uint32_t mask) {
+  inner_.clearMask(mask);
+  record(gpio_trace_kind::write, mask, 0);
+}
+
+/**
+ * @brief Drive the masked pins and record it as one event.
+ *
+ * @param mask Pin mask
+ * @param values Levels for the masked pins
+ */
+void tracing_gpio_driver::writePort(uint32_t mask, uint32_t values) {
+  inner_.writePort(mask, values);
+  record(gpio_trace_kind::write, mask, values);
+}
+
+/**
+ * @brief Read the masked pins and record the levels as one event.
+ *
+ * @param mask Pin mask
+ * @return uint32_t Levels, bit n for pin n, zero outside mask
+ */
+uint32_t tracing_gpio_driver::readMask(uint32_t mask) {
+  uint32_t levels = inner_.readMask(mask);
+  record(gpio_trace_kind::read, mask, levels);
+  return levels;
+}
+
+/**
+ * @brief Forward a direction change, which is not traced.
+ *
+ * @param pin Pin number
+ * @param output true to drive the pin, false to release it
+ */
+void tracing_gpio_driver::setDirection(int pin, bool output) {
+  inner_.setDirection(pin, output);
+}
+
+/**
+ * @brief Start a binary trace file.
+ *
+ * @param out Binary output stream
+ */
+void writeTraceHeader(std::ostream &out) {
+  out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+}
+
+/**
+ * @brief Append events to a binary trace file.
+ *
+ * @param out Stream positioned after the header
+ * @param events Events to write
+ * @param count Number of events
+ */
+void writeTraceEvents(std::ostream &out, const gpio_trace_event *events,
+                      std::size_t count) {
+  char record[TRACE_RECORD];
+  for (std::size_t i = 0; i < count; ++i) {
+    const gpio_trace_event &event = events[i];
+    for (int b = 0; b < 8; ++b)
+      record[b] = static_cast<char>(event.time >> (8 * b));
+    for (int b = 0; b < 4; ++b) {
+      record[8 + b] = static_cast<char>(event.mask >> (8 * b));
+      record[12 + b] = static_cast<char>(event.levels >> (8 * b));
+    }
+    record[16] = static_cast<char>(event.kind);
+    out.write(record, sizeof(record));
+  }
+}
+
+/**
+ * @brief Read a binary trace file.
+ *
+ * A truncated last record is ignored.
+ *
+ * @param in Binary input stream
+ * @param events Destination for the events
+ * @return true if the file is a trace, false if the magic is wrong
+ */
+bool readTrace(std::istream &in, std::vector<gpio_trace_event> &events) {
+  char magic[sizeof(TRACE_MAGIC)];
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+    return false;
+
+  unsigned char record[TRACE_RECORD];
+  while (in.read(reinterpret_cast<char *>(record), sizeof(record))) {
+    gpio_trace_event event{};
+    for (int b = 0; b < 8; ++b)
+      event.time |= uint64_t{record[b]} << (8 * b);
+    for (int b = 0; b < 4; ++b) {
+      event.mask |= uint32_t{record[8 + b]} << (8 * b);
+      event.levels |= uint32_t{record[12 + b]} << (8 * b);
+    }
+    event.kind = static_cast<gpio_trace_kind>(record[16]);
+    events.push_back(event);
+  }
+  return true;
+}
+
+/**
+ * @brief Export a trace as a Value Change Dump.
+ *
+ * Pins get the printable identifiers '!', '"', '#' and so on in
+ * the order they are named. Reads show up as well as writes, so
+ * MISO follows what the master actually sampled. A gap becomes
+ * a comment at its time stamp, the levels around it may jump.
+ *
+ * @param out Text output stream
+ * @param events Events in time order
+ * @param names Pins to export and their signal names
+ */
+void writeVcd(std::ostream &out, const std::vector<gpio_trace_event> &events,
+              const gpio_pin_names &names) {
+  out << "$timescale 1ns $end\n";
+  out << "$scope module bus $end\n";
+  for (std::size_t i = 0; i < names.size(); ++i)
+    out << "$var wire 1 " << static_cast<char>('!' + i) << ' '
+        << names[i].second << " $end\n";
+  out << "$upscope $end\n";
+  out << "$enddefinitions $end\n";
+
+  out << "$dumpvars\n";
+  for (std::size_t i = 0; i < names.size(); ++i)
+    out << 'x' << static_cast<char>('!' + i) << '\n';
+  out << "$end\n";
+
+  uint32_t known = 0;
+  uint32_t levels = 0;
+  for (const gpio_trace_event &event : events) {
+    if (event.kind == gpio_trace_kind::gap) {
+      out << '#' << event.time << '\n';
+      out << "$comment " << event.levels << " events dropped $end\n";
+      continue;
+    }
+
+    bool stamped = false;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      uint32_t mask = pinMask(names[i].first);
+      if (!(event.mask & mask))
+        continue;
+
+      bool level = event.levels & mask;
+      if ((known & mask) && ((levels & mask) != 0) == level)
+        continue;
+
+      if (!stamped) {
+        out << '#' << event.time << '\n';
+        stamped = true;
+      }
+      out << (level ? '1' : '0') << static_cast<char>('!' + i) << '\n';
+      known |= mask;
+      levels = level ? levels | mask : levels & ~mask;
+    }
+  }
+}
+
+/**
+ * @brief Decode SPI mode 0 transactions from a trace.
+ *
+ * The decoder replays the pin levels. Within one port write SCK
+ * is applied before CS, matching the electrical order the
+ * drivers use: CS falls first and rises last. A gap inside a
+ * transaction flags it; a transaction starting inside a gap is
+ * never seen selected, so its clocks and its CS rise are ignored.
+ *
+ * @param events Events in time order
+ * @param pins Bus wiring, data lines 0 and 1 only
+ * @return std::vector<spi_trace_transaction> Complete transactions
+ */
+std::vector<spi_trace_transaction>
+decodeSpi(const std::vector<gpio_trace_event> &events, spi_pin_map pins) {
+  const uint32_t maskCS = pinMask(pins.cs);
+  const uint32_t maskSCK = pinMask(pins.sck);
+  const uint32_t maskMOSI = pinMask(pins.mosi);
+  const uint32_t maskMISO = pinMask(pins.miso);
+
+  std::vector<spi_trace_transaction> result;
+  spi_trace_transaction current;
+  bool selected = false;
+  bool sck = false;
+  bool mosi = false;
+  bool miso = false;
+  // SCK rose and the MISO bit is not taken yet
+  bool bitOpen = false;
+  unsigned bits = 0;
+  uint8_t byteOut = 0;
+  uint8_t byteIn = 0;
+
+  auto closeBit = [&] {
+    if (!bitOpen)
+      return;
+    byteIn = static_cast<uint8_t>((byteIn << 1) | (miso ? 1 : 0));
+    if (++bits % 8 == 0) {
+      current.mosi.push_back(byteOut);
+      current.miso.push_back(byteIn);
+    }
+    bitOpen = false;
+  };
+
+  for (const gpio_trace_event &event : events) {
+    if (event.kind == gpio_trace_kind::gap) {
+      if (selected)
+        current.gap = true;
+      continue;
+    }
+
+    if (event.kind == gpio_trace_kind::read) {
+      if (event.mask & maskMISO)
+        miso = event.levels & maskMISO;
+      continue;
+    }
+
+    if (event.mask & maskMOSI)
+      mosi = event.levels & maskMOSI;
+
+    if (event.mask & maskCS) {
+      bool cs = event.levels & maskCS;
+      if (!cs && !selected) {
+        selected = true;
+        current = spi_trace_transaction{};
+        current.start = event.time;
+        bits = 0;
+        bitOpen = false;
+      }
+    }
+
+    if (event.mask & maskSCK) {
+      bool level = event.levels & maskSCK;
+      if (level != sck) {
+        sck = level;
+        if (selected && !sck) {
+          closeBit();
+        } else if (selected) {
+          closeBit();
+          byteOut = static_cast<uint8_t>((byteOut << 1) | (mosi ? 1 : 0));
+          bitOpen = true;
+        }
+      }
+    }
+
+    if ((event.mask & maskCS) && (event.levels & maskCS) && selected) {
+      closeBit();
+      current.end = event.time;
+      current.trailingBits = bits % 8;
+      result.push_back(std::move(current));
+      selected = false;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,83 @@
+#include "gpio_trace.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Print the command line help.
+ *
+ * @param program Name the tool was started as
+ */
+static void usage(const char *program) {
+  std::cerr << "usage: " << program
+            << " vcd|spi TRACE [CS SCK MOSI MISO]\n"
+               "  vcd  write a Value Change Dump of the bus pins to stdout\n"
+               "  spi  list the decoded SPI transactions\n"
+               "  pins default to 0 1 2 3\n";
+}
+
+/**
+ * @brief Print the decoded SPI transactions, one per line.
+ *
+ * @param transactions Decoded transactions
+ */
+static void printSpi(const std::vector<spi_trace_transaction> &transactions) {
+  for (const spi_trace_transaction &t : transactions) {
+    std::printf("%12llu ns %8llu ns  mosi",
+                static_cast<unsigned long long>(t.start),
+                static_cast<unsigned long long>(t.end - t.start));
+    for (uint8_t byte : t.mosi)
+      std::printf(" %02X", byte);
+    std::printf("  miso");
+    for (uint8_t byte : t.miso)
+      std::printf(" %02X", byte);
+    if (t.trailingBits)
+      std::printf("  +%u bits", t.trailingBits);
+    if (t.gap)
+      std::printf("  (events dropped)");
+    std::printf("\n");
+  }
+}
+
+/**
+ * @brief Offline decoder for traces recorded by tracing_gpio_driver.
+ *
+ * Reads a binary trace file and writes it as VCD or as a list of
+ * SPI transactions, so bus traffic can be inspected without
+ * slowing the traced bus down.
+ */
+int main(int argc, char **argv) {
+  if (argc != 3 && argc != 7) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  spi_pin_map pins{0, 1, 2, 3};
+  if (argc == 7)
+    pins = {std::atoi(argv[3]), std::atoi(argv[4]), std::atoi(argv[5]),
+            std::atoi(argv[6])};
+
+  std::ifstream in(argv[2], std::ios::binary);
+  std::vector<gpio_trace_event> events;
+  if (!in || !readTrace(in, events)) {
+    std::cerr << argv[2] << ": not a GPIO trace\n";
+    return EXIT_FAILURE;
+  }
+
+  std::string command = argv[1];
+  if (command == "vcd") {
+    writeVcd(std::cout, events,
+             {{pins.cs, "cs"},
+              {pins.sck, "sck"},
+              {pins.mosi, "mosi"},
+              {pins.miso, "miso"}});
+  } else if (command == "spi") {
+    printSpi(decodeSpi(events, pins));
+  } else {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -14,7 +14,7 @@ public:
    * @param pin Pin number
    */
   void setHigh(int pin) override {
-    std::cout << "Pin: " << pin << " HIGH" << std::endl;
+    std::cout << "Pin: " << pin << " HIGH\n";
   }
 
   /**
@@ -22,7 +22,7 @@ public:
    * @param pin Pin number
    */
   void setLow(int pin) override {
-    std::cout << "Pin: " << pin << " LOW" << std::endl;
+    std::cout << "Pin: " << pin << " LOW\n";
   }
 
   /**
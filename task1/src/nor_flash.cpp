@@ -0,0 +1,434 @@
+#include "nor_flash.hpp"
+#include <algorithm>
+#include <thread>
+
+/**
+ * @brief Construct a nor_flash_api object.
+ *
+ * @param spi Reference to SPI interface
+ * @param capacity Device size in bytes
+ */
+nor_flash_api::nor_flash_api(i_chip_spi_api &spi, uint32_t capacity)
+    : spi_api_(spi), capacity_(capacity), original_(SECTOR_SIZE),
+      image_(SECTOR_SIZE) {
+  selectReadMode();
+}
+
+/**
+ * @brief Destroy the nor_flash_api object.
+ *
+ * Pending writes are committed so nothing buffered is lost.
+ */
+nor_flash_api::~nor_flash_api() { flush(); }
+
+/**
+ * @brief Set the write enable latch.
+ *
+ * Required before every program and erase; the chip clears
+ * it when the operation finishes.
+ */
+void nor_flash_api::writeEnable() {
+  spi_api_.transaction(&CMD_WREN, nullptr, 1);
+}
+
+/**
+ * @brief Read status register 1.
+ *
+ * @return uint8_t Status register value
+ */
+uint8_t nor_flash_api::readStatus() {
+  const uint8_t tx[2] = {CMD_RDSR, 0x00};
+  uint8_t rx[2];
+
+  spi_api_.transaction(tx, rx, sizeof(tx));
+  return rx[1];
+}
+
+/**
+ * @brief Read status register 2.
+ *
+ * @return uint8_t Status register value
+ */
+uint8_t nor_flash_api::readStatus2() {
+  const uint8_t tx[2] = {CMD_RDSR2, 0x00};
+  uint8_t rx[2];
+
+  spi_api_.transaction(tx, rx, sizeof(tx));
+  return rx[1];
+}
+
+/**
+ * @brief Pick the widest read mode the bus and the chip support.
+ *
+ * @return nor_read_mode Selected mode
+ */
+nor_read_mode nor_flash_api::selectReadMode() {
+  unsigned lines = spi_api_.dataLines();
+
+  if (lines >= 4 && (readStatus2() & STATUS2_QE))
+    readMode_ = nor_read_mode::quad;
+  else if (lines >= 2)
+    readMode_ = nor_read_mode::dual;
+  else
+    readMode_ = nor_read_mode::standard;
+  return readMode_;
+}
+
+/**
+ * @brief Set the QE bit so the chip accepts Quad Output reads.
+ */
+void nor_flash_api::enableQuad() {
+  uint8_t status2 = readStatus2();
+  if (!(status2 & STATUS2_QE)) {
+    writeEnable();
+
+    const uint8_t tx[2] = {CMD_WRSR2,
+                           static_cast<uint8_t>(status2 | STATUS2_QE)};
+    spi_api_.select();
+    spi_api_.send(tx, sizeof(tx));
+    spi_api_.deselect();
+    waitUntilReady();
+  }
+  selectReadMode();
+}
+
+/**
+ * @brief Read a range straight from the chip in the current mode.
+ *
+ * Clock edges dominate a bit-banged read, so Dual and Quad Output
+ * cut the data phase to a half and a quarter of the SCK cycles.
+ *
+ * @param address Starting memory address
+ * @param buffer Pointer to buffer to store data
+ * @param length Number of bytes to read
+ */
+void nor_flash_api::readRaw(uint32_t address, uint8_t *buffer,
+                            std::size_t length) {
+  static constexpr uint8_t commands[] = {CMD_READ, CMD_FAST_READ,
+                                         CMD_DUAL_READ, CMD_QUAD_READ};
+  static constexpr unsigned widths[] = {1, 1, 2, 4};
+  auto mode = static_cast<std::size_t>(readMode_);
+
+  uint8_t header[HEADER_SIZE];
+  buildHeader(commands[mode], address, header);
+
+  spi_api_.select();
+  spi_api_.send(header, HEADER_SIZE);
+  if (readMode_ == nor_read_mode::standard)
+    spi_api_.receive(buffer, length);
+  else
+    spi_api_.receiveWide(buffer, length, widths[mode],
+                         FAST_READ_DUMMY_CYCLES);
+  spi_api_.deselect();
+}
+
+/**
+ * @brief Poll BUSY until the current program or erase finishes.
+ *
+ * Page programs take well under a millisecond and erases tens to
+ * hundreds, so polling backs off exponentially up to a cap
+ * instead of hammering the bus for the whole erase.
+ */
+void nor_flash_api::waitUntilReady() {
+  std::chrono::microseconds interval = POLL_INTERVAL;
+  while (readStatus() & STATUS_BUSY) {
+    std::this_thread::sleep_for(interval);
+    interval = std::min(interval * 2, MAX_POLL_INTERVAL);
+  }
+}
+
+/**
+ * @brief Read the JEDEC manufacturer and device ID.
+ *
+ * @return uint32_t ID as 0x00MMTTCC
+ */
+uint32_t nor_flash_api::readJedecId() {
+  const uint8_t tx[4] = {CMD_JEDEC_ID, 0x00, 0x00, 0x00};
+  uint8_t rx[4];
+
+  spi_api_.transaction(tx, rx, sizeof(tx));
+  return (uint32_t{rx[1]} << 16) | (uint32_t{rx[2]} << 8) | rx[3];
+}
+
+/**
+ * @brief Encode a command and its 24-bit address into a header.
+ *
+ * @param command Command opcode
+ * @param address Memory address
+ * @param header Output buffer of at least HEADER_SIZE bytes
+ */
+void nor_flash_api::buildHeader(uint8_t command, uint32_t address,
+                                uint8_t *header) {
+  header[0] = command;
+  header[1] = (address >> 16) & 0xFF;
+  header[2] = (address >> 8) & 0xFF;
+  header[3] = address & 0xFF;
+}
+
+/**
+ * @brief Issue Page Program and wait for it to finish.
+ *
+ * Header and payload go out as one contiguous buffer.
+ *
+ * @param address Address of the first byte
+ * @param data Pointer to data buffer
+ * @param length Number of bytes, must not cross a page boundary
+ */
+void nor_flash_api::program(uint32_t address, const uint8_t *data,
+                            std::size_t length) {
+  if (length == 0)
+    return;
+
+  writeEnable();
+
+  uint8_t frame[HEADER_SIZE + PAGE_SIZE];
+  buildHeader(CMD_PP, address, frame);
+  std::copy(data, data + length, frame + HEADER_SIZE);
+
+  spi_api_.transaction(frame, nullptr, HEADER_SIZE + length);
+
+  ++stats_.pagePrograms;
+  stats_.bytesProgrammed += length;
+  waitUntilReady();
+}
+
+/**
+ * @brief Issue an erase command and wait for it to finish.
+ *
+ * @param command Erase opcode
+ * @param address Any address inside the block
+ */
+void nor_flash_api::erase(uint8_t command, uint32_t address) {
+  writeEnable();
+
+  uint8_t header[HEADER_SIZE];
+  buildHeader(command, address % capacity_, header);
+
+  spi_api_.transaction(header, nullptr, HEADER_SIZE);
+
+  ++stats_.erases;
+  waitUntilReady();
+}
+
+/**
+ * @brief Program up to one page with a single Page Program command.
+ *
+ * The length is clamped to the rest of the page: the chip would
+ * wrap to the start of the page, and program() frames at most
+ * one page.
+ *
+ * @param address Address of the first byte
+ * @param data Pointer to data buffer
+ * @param length Number of bytes
+ * @return std::size_t Bytes programmed, at most up to the page end
+ */
+std::size_t nor_flash_api::programPage(uint32_t address, const uint8_t *data,
+                                       std::size_t length) {
+  flush();
+  sectorLoaded_ = false;
+  address %= capacity_;
+  length = std::min(length, PAGE_SIZE - address % PAGE_SIZE);
+  program(address, data, length);
+  return length;
+}
+
+/**
+ * @brief Erase the 4 KB sector holding an address.
+ *
+ * @param address Any address inside the sector
+ */
+void nor_flash_api::eraseSector(uint32_t address) {
+  flush();
+  sectorLoaded_ = false;
+  erase(CMD_SE, address);
+}
+
+/**
+ * @brief Erase the 32 KB block holding an address.
+ *
+ * @param address Any address inside the block
+ */
+void nor_flash_api::eraseBlock32(uint32_t address) {
+  flush();
+  sectorLoaded_ = false;
+  erase(CMD_BE32, address);
+}
+
+/**
+ * @brief Erase the 64 KB block holding an address.
+ *
+ * @param address Any address inside the block
+ */
+void nor_flash_api::eraseBlock64(uint32_t address) {
+  flush();
+  sectorLoaded_ = false;
+  erase(CMD_BE64, address);
+}
+
+/**
+ * @brief Make a sector the buffered one, committing the previous.
+ *
+ * @param base Sector base address
+ */
+void nor_flash_api::loadSector(uint32_t base) {
+  if (sectorLoaded_ && sectorBase_ == base)
+    return;
+
+  flush();
+
+  readRaw(base, original_.data(), SECTOR_SIZE);
+  image_ = original_;
+  sectorBase_ = base;
+  sectorLoaded_ = true;
+}
+
+/**
+ * @brief Program a sector image, erasing first only if needed.
+ *
+ * NOR programming can only clear bits. If every changed byte
+ * only loses bits, the changed span of each page is programmed
+ * in place. Otherwise the sector is erased and every page that
+ * holds anything but 0xFF is programmed back.
+ */
+void nor_flash_api::commitSector() {
+  bool needsErase = false;
+  for (std::size_t i = 0; i < SECTOR_SIZE && !needsErase; ++i)
+    needsErase = (~original_[i] & image_[i]) != 0;
+
+  // after an erase the chip holds 0xFF, diff against that
+  if (needsErase) {
+    erase(CMD_SE, sectorBase_);
+    std::fill(original_.begin(), original_.end(), 0xFF);
+  } else {
+    ++stats_.inPlaceCommits;
+  }
+
+  for (std::size_t page = 0; page < SECTOR_SIZE; page += PAGE_SIZE) {
+    std::size_t first = page;
+    std::size_t last = page + PAGE_SIZE;
+    while (first < last && original_[first] == image_[first])
+      ++first;
+    while (last > first && original_[last - 1] == image_[last - 1])
+      --last;
+
+    program(sectorBase_ + first, image_.data() + first, last - first);
+  }
+
+  original_ = image_;
+}
+
+/**
+ * @brief Commit the buffered sector to the chip.
+ */
+void nor_flash_api::flush() {
+  if (!sectorDirty_)
+    return;
+
+  commitSector();
+  sectorDirty_ = false;
+}
+
+/**
+ * @brief Write multiple bytes through the sector buffer.
+ *
+ * @param address Starting memory address
+ * @param data Pointer to data buffer
+ * @param length Number of bytes to write
+ */
+void nor_flash_api::writeBuffer(uint32_t address, const uint8_t *data,
+                                std::size_t length) {
+  while (length > 0) {
+    address %= capacity_;
+    uint32_t offset = address % SECTOR_SIZE;
+    std::size_t chunk = std::min(length, SECTOR_SIZE - offset);
+
+    loadSector(address - offset);
+    if (!std::equal(data, data + chunk, image_.begin() + offset)) {
+      std::copy(data, data + chunk, image_.begin() + offset);
+      sectorDirty_ = true;
+    }
+
+    address += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+/**
+ * @brief Read multiple bytes, seeing writes still in the buffer.
+ *
+ * A range inside the buffered sector is served from RAM;
+ * anything else is one READ transaction with the buffered
+ * bytes laid over it.
+ *
+ * @param address Starting memory address
+ * @param buffer Pointer to buffer to store data
+ * @param length Number of bytes to read
+ */
+void nor_flash_api::readBuffer(uint32_t address, uint8_t *buffer,
+                               std::size_t length) {
+  if (length == 0)
+    return;
+  address %= capacity_;
+
+  uint32_t offset = address - sectorBase_;
+  if (sectorLoaded_ && offset < SECTOR_SIZE && length <= SECTOR_SIZE - offset) {
+    std::copy_n(image_.begin() + offset, length, buffer);
+    return;
+  }
+
+  readRaw(address, buffer, length);
+
+  if (!sectorDirty_)
+    return;
+  for (std::size_t i = 0; i < length; ++i) {
+    uint32_t inSector = (address + i) % capacity_ - sectorBase_;
+    if (inSector < SECTOR_SIZE)
+      buffer[i] = image_[inSector];
+  }
+}
+
+/**
+ * @brief Write a single byte through the sector buffer.
+ *
+ * @param address Memory address to write to
+ * @param data Byte to write
+ */
+void nor_flash_api::writeByte(uint32_t address, uint8_t data) {
+  writeBuffer(address, &data, 1);
+}
+
+/**
+ * @brief Read a single byte.
+ *
+ * @param address Memory address to read
+ * @return uint8_t Value read from memory
+ */
+uint8_t nor_flash_api::readByte(uint32_t address) {
+  uint8_t data = 0;
+  readBuffer(address, &data, 1);
+  return data;
+}
+
+/**
+ * @brief Write a single bit through the sector buffer.
+ *
+ * @param address Memory address
+ * @param bitPosition Bit index (0-7)
+ * @param value Boolean value to write
+ */
+void nor_flash_api::writeBit(uint32_t address, uint8_t bitPosition,
+                             bool value) {
+  updateBits(address, 1 << bitPosition, value ? 0xFF : 0x00);
+}
+
+/**
+ * @brief Read a single bit.
+ *
+ * @param address Memory address
+ * @param bitPosition Bit index (0-7)
+ * @return true if bit is 1, false if 0
+ */
+bool nor_flash_api::readBit(uint32_t address, uint8_t bitPosition) {
+  return (readByte(address) >> bitPosition) & 0x01;
+}
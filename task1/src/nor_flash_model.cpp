@@ -0,0 +1,270 @@
+#include "nor_flash_model.hpp"
+#include <algorithm>
+
+/**
+ * @brief Construct a model filled with 0xFF, the erased state.
+ *
+ * @param config Geometry, timing and wiring
+ */
+nor_flash_model::nor_flash_model(nor_flash_model_config config)
+    : spi_device_model(config.pins, config.portAccess), config_(config),
+      memory_(config.capacity, 0xFF), pageBuffer_(PAGE_SIZE),
+      pageLatched_(PAGE_SIZE),
+      status2_(config.quadEnable ? STATUS2_QE : 0) {}
+
+/**
+ * @brief Get status register 1 as RDSR would return it.
+ *
+ * @return uint8_t Status register value
+ */
+uint8_t nor_flash_model::status() {
+  updateBusy();
+  return (busy_ ? STATUS_BUSY : 0) | (wel_ ? STATUS_WEL : 0);
+}
+
+/**
+ * @brief Tell whether a program or erase is in progress.
+ *
+ * @return true while BUSY is set
+ */
+bool nor_flash_model::busy() {
+  updateBusy();
+  return busy_;
+}
+
+/**
+ * @brief Reset the pin, program and erase counters.
+ */
+void nor_flash_model::resetCounters() {
+  spi_device_model::resetCounters();
+  pagePrograms_ = 0;
+  erases_ = 0;
+}
+
+/**
+ * @brief Start a new transaction on the CS falling edge.
+ */
+void nor_flash_model::onSelect() {
+  phase_ = phase::command;
+  opcode_ = 0;
+  statusReceived_ = 0;
+}
+
+/**
+ * @brief Finish the transaction on the CS rising edge.
+ *
+ * Program and erase only start when CS rises on a byte boundary
+ * with the latch set. An erase must carry exactly its address.
+ *
+ * @param aligned CS rose on a byte boundary
+ */
+void nor_flash_model::onDeselect(bool aligned) {
+  bool erase_framed = aligned && bitsReceived() == 32;
+
+  switch (opcode_) {
+  case CMD_WREN:
+    wel_ = true;
+    break;
+  case CMD_WRDI:
+    wel_ = false;
+    break;
+  case CMD_PP: {
+    bool latched =
+        std::find(pageLatched_.begin(), pageLatched_.end(), true) !=
+        pageLatched_.end();
+    if (!wel_ || !aligned || !latched)
+      break;
+    // programming can only pull bits to 0
+    for (std::size_t i = 0; i < PAGE_SIZE; ++i)
+      if (pageLatched_[i])
+        memory_[pageBase_ + i] &= pageBuffer_[i];
+    ++pagePrograms_;
+    startBusy(config_.pageProgram);
+    break;
+  }
+  case CMD_WRSR:
+  case CMD_WRSR2:
+    if (!wel_ || !aligned || statusReceived_ == 0)
+      break;
+    // WRSR carries SR1 first, SR2 second; only QE is modelled
+    if (opcode_ == CMD_WRSR2)
+      status2_ = newStatus_[0] & STATUS2_QE;
+    else if (statusReceived_ == 2)
+      status2_ = newStatus_[1] & STATUS2_QE;
+    startBusy(config_.statusWrite);
+    break;
+  case CMD_SE:
+    if (wel_ && erase_framed)
+      erase(4 * 1024, config_.sectorErase);
+    break;
+  case CMD_BE32:
+    if (wel_ && erase_framed)
+      erase(32 * 1024, config_.block32Erase);
+    break;
+  case CMD_BE64:
+    if (wel_ && erase_framed)
+      erase(64 * 1024, config_.block64Erase);
+    break;
+  default:
+    break;
+  }
+  opcode_ = 0;
+}
+
+/**
+ * @brief Supply the next byte of an output stream.
+ *
+ * READ moves on to the next address, rolling over at the end of
+ * memory; registers repeat their last byte.
+ *
+ * @return uint8_t Next output byte
+ */
+uint8_t nor_flash_model::nextOutput() {
+  if (phase_ == phase::read) {
+    address_ = (address_ + 1) % config_.capacity;
+    return memory_[address_];
+  }
+  if (output_ == nullptr)
+    return status();
+  outputIndex_ = std::min(outputIndex_ + 1, outputLength_ - 1);
+  return output_[outputIndex_];
+}
+
+/**
+ * @brief Handle a fully received byte.
+ *
+ * @param byte Received byte
+ */
+void nor_flash_model::onByte(uint8_t byte) {
+  switch (phase_) {
+  case phase::command:
+    phase_ = phase::ignore;
+    updateBusy();
+
+    // only RDSR gets through while BUSY is set
+    if (busy_ && byte != CMD_RDSR)
+      return;
+
+    opcode_ = byte;
+    switch (byte) {
+    case CMD_QUAD_READ:
+      if (!(status2_ & STATUS2_QE))
+        break;
+      [[fallthrough]];
+    case CMD_READ:
+    case CMD_FAST_READ:
+    case CMD_DUAL_READ:
+    case CMD_PP:
+    case CMD_SE:
+    case CMD_BE32:
+    case CMD_BE64:
+      address_ = 0;
+      addressLeft_ = 3;
+      std::fill(pageLatched_.begin(), pageLatched_.end(), false);
+      phase_ = phase::address;
+      break;
+    case CMD_RDSR:
+      output_ = nullptr;
+      startOutput(status());
+      phase_ = phase::output;
+      break;
+    case CMD_RDSR2:
+      output_ = &status2_;
+      outputLength_ = 1;
+      outputIndex_ = 0;
+      startOutput(status2_);
+      phase_ = phase::output;
+      break;
+    case CMD_WRSR:
+    case CMD_WRSR2:
+      phase_ = phase::status;
+      break;
+    case CMD_JEDEC_ID:
+      output_ = JEDEC_ID;
+      outputLength_ = sizeof(JEDEC_ID);
+      outputIndex_ = 0;
+      startOutput(JEDEC_ID[0]);
+      phase_ = phase::output;
+      break;
+    default:
+      break;
+    }
+    break;
+  case phase::address:
+    address_ = (address_ << 8) | byte;
+    if (--addressLeft_ > 0)
+      break;
+    address_ %= config_.capacity;
+    if (opcode_ == CMD_READ) {
+      readWidth_ = 1;
+      startOutput(memory_[address_]);
+      phase_ = phase::read;
+    } else if (opcode_ == CMD_FAST_READ || opcode_ == CMD_DUAL_READ ||
+               opcode_ == CMD_QUAD_READ) {
+      readWidth_ = opcode_ == CMD_QUAD_READ   ? 4
+                   : opcode_ == CMD_DUAL_READ ? 2
+                                              : 1;
+      phase_ = phase::dummy;
+    } else if (opcode_ == CMD_PP) {
+      pageBase_ = address_ - address_ % PAGE_SIZE;
+      phase_ = phase::program;
+    } else {
+      phase_ = phase::ignore;
+    }
+    break;
+  case phase::dummy:
+    startOutput(memory_[address_], readWidth_);
+    phase_ = phase::read;
+    break;
+  case phase::status:
+    if (statusReceived_ < 2)
+      newStatus_[statusReceived_++] = byte;
+    break;
+  case phase::program: {
+    std::size_t offset = address_ - pageBase_;
+    pageBuffer_[offset] = byte;
+    pageLatched_[offset] = true;
+    address_ = pageBase_ + (offset + 1) % PAGE_SIZE;
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Erase the block holding the current address.
+ *
+ * @param size Block size in bytes
+ * @param duration Emulated erase time
+ */
+void nor_flash_model::erase(std::size_t size,
+                            std::chrono::microseconds duration) {
+  std::size_t base = address_ - address_ % size;
+  std::fill(memory_.begin() + base,
+            memory_.begin() + std::min(base + size, memory_.size()), 0xFF);
+  ++erases_;
+  startBusy(duration);
+}
+
+/**
+ * @brief Set BUSY for an emulated operation time.
+ *
+ * @param duration Operation time
+ */
+void nor_flash_model::startBusy(std::chrono::microseconds duration) {
+  busy_ = true;
+  busyUntil_ = std::chrono::steady_clock::now() + duration;
+}
+
+/**
+ * @brief Retire a finished program or erase.
+ *
+ * BUSY and WEL both clear when the operation ends.
+ */
+void nor_flash_model::updateBusy() {
+  if (!busy_ || std::chrono::steady_clock::now() < busyUntil_)
+    return;
+  busy_ = false;
+  wel_ = false;
+}
@@ -0,0 +1,354 @@
+#include "record_store.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief Continue a CRC-8 (polynomial 0x07) over a byte range.
+ *
+ * @param crc CRC of the preceding bytes
+ * @param data Bytes to add
+ * @param length Number of bytes
+ * @return uint8_t Updated CRC
+ */
+static uint8_t crc8(uint8_t crc, const uint8_t *data, std::size_t length) {
+  for (std::size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07)
+                         : static_cast<uint8_t>(crc << 1);
+  }
+  return crc;
+}
+
+/**
+ * @brief Compute the CRC of a record: header up to the CRC, then the value.
+ *
+ * Starts from 0xFF rather than 0x00, otherwise a zero-filled page
+ * (key 0, length 0, sequence 0, CRC 0) would pass as a record.
+ *
+ * @param record First byte of the record
+ * @param length Value length
+ * @return uint8_t Record CRC
+ */
+static uint8_t recordCrc(const uint8_t *record, std::size_t length) {
+  uint8_t crc = crc8(0xFF, record, record_store::HEADER_SIZE - 1);
+  return crc8(crc, record + record_store::HEADER_SIZE, length);
+}
+
+/**
+ * @brief Get the sequence number of a record.
+ *
+ * @param record First byte of the record
+ * @return uint16_t Sequence number, little endian on the device
+ */
+static uint16_t sequenceOf(const uint8_t *record) {
+  return static_cast<uint16_t>(record[2] | (record[3] << 8));
+}
+
+/**
+ * @brief Compare sequence numbers in serial number arithmetic.
+ *
+ * Every record on the device was written within the last lap of
+ * the log, so the numbers are never half the range apart.
+ *
+ * @param a Sequence number
+ * @param b Sequence number
+ * @return true if a was written after b
+ */
+static bool isNewer(uint16_t a, uint16_t b) {
+  return static_cast<int16_t>(a - b) > 0;
+}
+
+/**
+ * @brief Construct the store over a device and mount it.
+ *
+ * @param device Backing device
+ * @param capacity Device size in bytes
+ * @param pageSize Device write page size in bytes, at most 132
+ * @throw std::invalid_argument if a value length would not fit the
+ * length byte, a page cannot hold a header, there are fewer than
+ * three pages or page offsets would not fit 16 bits
+ */
+record_store::record_store(i_memory_device_api &device, std::size_t capacity,
+                           std::size_t pageSize)
+    : device_(device), image_(capacity), pageSize_(pageSize),
+      pages_(pageSize ? capacity / pageSize : 0) {
+  if (pageSize < HEADER_SIZE || pageSize > HEADER_SIZE + LENGTH_MASK)
+    throw std::invalid_argument("record_store: page size out of range");
+  if (pages_ < 3)
+    throw std::invalid_argument("record_store: at least 3 pages");
+  if (capacity > (std::size_t{1} << 16))
+    throw std::invalid_argument("record_store: at most 64 KB");
+  mount();
+}
+
+/**
+ * @brief Rebuild the index from the device contents.
+ *
+ * One sequential read fills the image. The newest record of each
+ * key goes into the index, the head follows the newest record of
+ * all, and the log tail is the first page after the head that
+ * compaction has to keep; the pages in between are free.
+ */
+void record_store::mount() {
+  device_.readBuffer(0, image_.data(), image_.size());
+
+  index_.fill(NOWHERE);
+  copies_.fill(0);
+
+  bool found = false;
+  std::size_t newest = 0;
+  for (std::size_t page = 0; page < pages_; ++page) {
+    uint8_t key = keyOf(page);
+    if (key == NO_KEY)
+      continue;
+
+    ++copies_[key];
+    uint16_t sequence = sequenceOf(pageData(page));
+    if (index_[key] == NOWHERE ||
+        isNewer(sequence, sequenceOf(pageData(index_[key]))))
+      index_[key] = static_cast<int16_t>(page);
+    if (!found || isNewer(sequence, sequenceOf(pageData(newest)))) {
+      newest = page;
+      found = true;
+    }
+  }
+
+  head_ = found ? (newest + 1) % pages_ : 0;
+  sequence_ = found ? sequenceOf(pageData(newest)) + 1 : 0;
+
+  // tombstones with nothing left to hide resolve to a missing key
+  for (std::size_t key = 0; key < index_.size(); ++key)
+    if (index_[key] != NOWHERE && isTombstone(index_[key]) &&
+        copies_[key] == 1)
+      index_[key] = NOWHERE;
+
+  free_ = pages_;
+  tail_ = head_;
+  for (std::size_t step = 0; step < pages_; ++step) {
+    std::size_t page = (head_ + step) % pages_;
+    if (isLive(page)) {
+      tail_ = page;
+      free_ = step;
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Tell whether a page holds a record with a valid CRC.
+ *
+ * @param page Page index
+ * @return true if the header and value check out
+ */
+bool record_store::isRecord(std::size_t page) const {
+  const uint8_t *record = pageData(page);
+  std::size_t length = record[1] & LENGTH_MASK;
+  if (record[0] == NO_KEY || length > maxValueSize())
+    return false;
+  return recordCrc(record, length) == record[HEADER_SIZE - 1];
+}
+
+/**
+ * @brief Get the key of a page, NO_KEY if it holds no record.
+ *
+ * @param page Page index
+ * @return uint8_t Record key
+ */
+uint8_t record_store::keyOf(std::size_t page) const {
+  return isRecord(page) ? pageData(page)[0] : NO_KEY;
+}
+
+/**
+ * @brief Tell whether a page holds the record a key resolves to.
+ *
+ * @param page Page index
+ * @return true if compaction has to keep the record
+ */
+bool record_store::isLive(std::size_t page) const {
+  uint8_t key = keyOf(page);
+  if (key == NO_KEY || index_[key] != static_cast<int16_t>(page))
+    return false;
+  return !isTombstone(page) || copies_[key] > 1;
+}
+
+/**
+ * @brief Count the pages compaction has to keep.
+ *
+ * @return std::size_t Live record count
+ */
+std::size_t record_store::livePages() const {
+  std::size_t count = 0;
+  for (std::size_t key = 0; key < index_.size(); ++key)
+    if (index_[key] != NOWHERE &&
+        (!isTombstone(index_[key]) || copies_[key] > 1))
+      ++count;
+  return count;
+}
+
+/**
+ * @brief Write a record at the head of the log.
+ *
+ * The record is built in the image and only its header and
+ * value go to the device, in one page write. Whatever the head
+ * page held before is gone from the index.
+ *
+ * @param key Record key
+ * @param flags Length byte flags, TOMBSTONE or 0
+ * @param data Value bytes
+ * @param length Value length
+ * @return std::size_t Page the record went to
+ */
+std::size_t record_store::append(uint8_t key, uint8_t flags,
+                                 const uint8_t *data, std::size_t length) {
+  std::size_t page = head_;
+  uint8_t previous = keyOf(page);
+  if (previous != NO_KEY && --copies_[previous] == 0)
+    index_[previous] = NOWHERE;
+
+  uint8_t *record = pageData(page);
+  std::copy(data, data + length, record + HEADER_SIZE);
+  record[0] = key;
+  record[1] = static_cast<uint8_t>(flags | length);
+  record[2] = static_cast<uint8_t>(sequence_ & 0xFF);
+  record[3] = static_cast<uint8_t>(sequence_ >> 8);
+  record[HEADER_SIZE - 1] = recordCrc(record, length);
+
+  device_.writeBuffer(static_cast<uint16_t>(page * pageSize_), record,
+                      HEADER_SIZE + length);
+
+  ++copies_[key];
+  index_[key] = static_cast<int16_t>(page);
+  head_ = (head_ + 1) % pages_;
+  --free_;
+  ++sequence_;
+  return page;
+}
+
+/**
+ * @brief Compact until at least two pages are free.
+ *
+ * One free page takes the new record, the other keeps room for
+ * compaction to move a live record off the tail.
+ *
+ * @return true if the pages are available
+ */
+bool record_store::reserve() {
+  while (free_ < 2)
+    if (!compactStep())
+      return false;
+  return true;
+}
+
+/**
+ * @brief Reclaim one page at the tail of the log.
+ *
+ * @return true if a page was reclaimed, false if every used
+ * page still holds a live record
+ */
+bool record_store::compactStep() {
+  if (free_ == pages_ || livePages() == pages_ - free_)
+    return false;
+
+  if (isLive(tail_)) {
+    if (free_ == 0)
+      return false;
+
+    // the copy at the head supersedes the tail record
+    const uint8_t *record = pageData(tail_);
+    append(record[0], record[1] & TOMBSTONE, record + HEADER_SIZE,
+           record[1] & LENGTH_MASK);
+    ++stats_.relocations;
+  } else {
+    ++stats_.reclaimed;
+  }
+
+  tail_ = (tail_ + 1) % pages_;
+  ++free_;
+  return true;
+}
+
+/**
+ * @brief Store a value under a key.
+ *
+ * A value equal to the stored one costs no write.
+ *
+ * @param key Record key, 0..254
+ * @param data Value bytes
+ * @param length Value length, at most maxValueSize()
+ * @return true if the value is stored
+ */
+bool record_store::put(uint8_t key, const uint8_t *data, std::size_t length) {
+  if (key == NO_KEY || length > maxValueSize())
+    return false;
+
+  if (contains(key)) {
+    const uint8_t *value = pageData(index_[key]) + HEADER_SIZE;
+    if (this->length(key) == length && std::equal(data, data + length, value)) {
+      ++stats_.unchanged;
+      return true;
+    }
+  } else if (livePages() + 1 > maxRecords()) {
+    return false;
+  }
+
+  if (!reserve())
+    return false;
+
+  append(key, 0, data, length);
+  ++stats_.appends;
+  return true;
+}
+
+/**
+ * @brief Remove a key by appending a tombstone.
+ *
+ * @param key Record key
+ * @return true if the key existed
+ */
+bool record_store::erase(uint8_t key) {
+  if (!contains(key) || !reserve())
+    return false;
+
+  append(key, TOMBSTONE, nullptr, 0);
+  ++stats_.appends;
+  return true;
+}
+
+/**
+ * @brief Tell whether a key holds a value.
+ *
+ * @param key Record key
+ * @return true if the key exists
+ */
+bool record_store::contains(uint8_t key) const {
+  return key != NO_KEY && index_[key] != NOWHERE && !isTombstone(index_[key]);
+}
+
+/**
+ * @brief Get the length of the value stored under a key.
+ *
+ * @param key Record key
+ * @return std::size_t Value length, 0 if the key does not exist
+ */
+std::size_t record_store::length(uint8_t key) const {
+  if (!contains(key))
+    return 0;
+  return pageData(index_[key])[1] & LENGTH_MASK;
+}
+
+/**
+ * @brief Copy the value stored under a key out of RAM.
+ *
+ * @param key Record key
+ * @param buffer Destination buffer
+ * @param size Buffer size
+ * @return std::size_t Bytes copied, 0 if the key does not exist
+ */
+std::size_t record_store::read(uint8_t key, uint8_t *buffer,
+                               std::size_t size) const {
+  std::size_t count = std::min(length(key), size);
+  if (count > 0)
+    std::copy_n(pageData(index_[key]) + HEADER_SIZE, count, buffer);
+  return count;
+}
@@ -0,0 +1,107 @@
+#include "spi_bus.hpp"
+
+/**
+ * @brief Select the chip, taking the bus over from any other chip.
+ */
+void spi_bus_device::select() { bus_.select(pinCS_); }
+
+/**
+ * @brief Deselect the chip.
+ */
+void spi_bus_device::deselect() { bus_.deselect(pinCS_); }
+
+/**
+ * @brief Tell whether another chip took the bus since select().
+ *
+ * @return true if the bus is no longer held by this chip
+ */
+bool spi_bus_device::preempted() const { return bus_.active_ != pinCS_; }
+
+/**
+ * @brief Transfer a byte on the shared lines, MSB first.
+ *
+ * @param data Byte to send
+ * @return uint8_t Received byte
+ */
+uint8_t spi_bus_device::transfer(uint8_t data) {
+  return bus_.spi_.transfer(data);
+}
+
+/**
+ * @brief Transfer a buffer on the shared lines in one pass.
+ *
+ * @param tx Bytes to send, or nullptr to send 0x00
+ * @param rx Buffer for received bytes, or nullptr to discard them
+ * @param length Number of bytes to transfer
+ */
+void spi_bus_device::transfer(const uint8_t *tx, uint8_t *rx,
+                              std::size_t length) {
+  bus_.spi_.transfer(tx, rx, length);
+}
+
+/**
+ * @brief Construct the bus and put the shared lines into idle state.
+ *
+ * The engine runs without a CS pin of its own: the bus drives
+ * the CS line of whichever chip is selected.
+ *
+ * @param gpio Reference to GPIO driver
+ * @param pinSCK SPI clock pin
+ * @param pinMOSI SPI MOSI pin
+ * @param pinMISO SPI MISO pin
+ * @param timing Delay policy between SCK edges
+ */
+spi_bus::spi_bus(i_chip_gpio_driver &gpio, int pinSCK, int pinMOSI,
+                 int pinMISO, spi_timing timing)
+    : gpio_(gpio), spi_(gpio, spi_pin_map{-1, pinSCK, pinMOSI, pinMISO},
+                        timing) {
+  gpio_.setDirection(pinMOSI, true);
+  gpio_.setDirection(pinMISO, false);
+}
+
+/**
+ * @brief Add a chip on its own CS line.
+ *
+ * @param pinCS Chip select pin, driven high here
+ * @return spi_bus_device& Transport for the chip driver
+ */
+spi_bus_device &spi_bus::attach(int pinCS) {
+  gpio_.setDirection(pinCS, true);
+  gpio_.setHigh(pinCS);
+  spi_.counters().onGpio(1);
+  return devices_.emplace_back(*this, pinCS);
+}
+
+/**
+ * @brief Give the bus to a chip by pulling its CS low.
+ *
+ * A chip still holding the bus, typically an EEPROM read stream
+ * left open, is deselected first; two chips driving MISO at once
+ * would corrupt both transfers.
+ *
+ * @param pinCS Chip select pin
+ */
+void spi_bus::select(int pinCS) {
+  if (active_ >= 0 && active_ != pinCS) {
+    gpio_.setHigh(active_);
+    spi_.counters().onGpio(1);
+    ++preemptions_;
+  }
+
+  spi_.select();
+  gpio_.setLow(pinCS);
+  spi_.counters().onGpio(1);
+  active_ = pinCS;
+}
+
+/**
+ * @brief Pull a chip's CS high and free the bus if it held it.
+ *
+ * @param pinCS Chip select pin
+ */
+void spi_bus::deselect(int pinCS) {
+  gpio_.setHigh(pinCS);
+  spi_.counters().onGpio(1);
+  if (active_ == pinCS)
+    active_ = -1;
+}
@@ -0,0 +1,380 @@
+#include "spi_device_model.hpp"
+#include <bit>
+
+/**
+ * @brief Pick a pin's level out of a port write.
+ *
+ * @param mask Pins being written
+ * @param values New levels for the pins in mask
+ * @param pin Pin of interest
+ * @param current Level kept when the pin is not in mask
+ * @return bool New level of the pin
+ */
+static bool portLevel(uint32_t mask, uint32_t values, int pin, bool current) {
+  if (pin < 0 || pin >= 32 || !(mask & (uint32_t{1} << pin)))
+    return current;
+  return values & (uint32_t{1} << pin);
+}
+
+/**
+ * @brief Construct the front end with the bus idle.
+ *
+ * @param pins Wiring
+ * @param portAccess Advertise setMask/writePort
+ */
+spi_device_model::spi_device_model(spi_model_pins pins, bool portAccess)
+    : pins_(pins), portAccess_(portAccess) {}
+
+/**
+ * @brief Drive a pin high.
+ *
+ * @param pin Pin number
+ */
+void spi_device_model::setHigh(int pin) {
+  ++pinWrites_;
+  int line = lineOf(pin);
+  if (line >= 2)
+    io_[line] = true;
+  apply(pin == pins_.cs || cs_, pin == pins_.sck || sck_,
+        pin == pins_.mosi || io_[0]);
+}
+
+/**
+ * @brief Drive a pin low.
+ *
+ * @param pin Pin number
+ */
+void spi_device_model::setLow(int pin) {
+  ++pinWrites_;
+  int line = lineOf(pin);
+  if (line >= 2)
+    io_[line] = false;
+  apply(pin != pins_.cs && cs_, pin != pins_.sck && sck_,
+        pin != pins_.mosi && io_[0]);
+}
+
+/**
+ * @brief Read a pin level.
+ *
+ * @param pin Pin number
+ * @return bool Pin level
+ */
+bool spi_device_model::read(int pin) {
+  ++pinReads_;
+  return level(pin);
+}
+
+/**
+ * @brief Read the levels of every pin in a mask in one port read.
+ *
+ * @param mask Pin mask
+ * @return uint32_t Levels, bit n for pin n, zero outside mask
+ */
+uint32_t spi_device_model::readMask(uint32_t mask) {
+  ++pinReads_;
+  uint32_t levels = 0;
+  for (; mask; mask &= mask - 1) {
+    int pin = std::countr_zero(mask);
+    if (level(pin))
+      levels |= uint32_t{1} << pin;
+  }
+  return levels;
+}
+
+/**
+ * @brief Drive every pin in a mask high in one port write.
+ *
+ * @param mask Bit mask of pins
+ */
+void spi_device_model::setMask(uint32_t mask) { writePort(mask, mask); }
+
+/**
+ * @brief Drive every pin in a mask low in one port write.
+ *
+ * @param mask Bit mask of pins
+ */
+void spi_device_model::clearMask(uint32_t mask) { writePort(mask, 0); }
+
+/**
+ * @brief Set the pins in a mask to the given levels in one port write.
+ *
+ * @param mask Pins to change
+ * @param values New levels for the pins in mask
+ */
+void spi_device_model::writePort(uint32_t mask, uint32_t values) {
+  ++pinWrites_;
+  io_[2] = portLevel(mask, values, pins_.io2, io_[2]);
+  io_[3] = portLevel(mask, values, pins_.io3, io_[3]);
+  apply(portLevel(mask, values, pins_.cs, cs_),
+        portLevel(mask, values, pins_.sck, sck_),
+        portLevel(mask, values, pins_.mosi, io_[0]));
+}
+
+/**
+ * @brief Replay a waveform the way a DMA-capable backend would.
+ *
+ * The edges go straight to the port write without another trip
+ * through the virtual interface per edge.
+ *
+ * @param edges Edge list, see spi_waveform
+ * @param count Number of edges
+ * @param sampleMask Input pins to sample
+ * @param rxOut Buffer for one byte per 8 samples, or nullptr
+ */
+void spi_device_model::submit(const gpio_edge *edges, std::size_t count,
+                              uint32_t sampleMask, uint8_t *rxOut) {
+  std::size_t bit = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    spi_device_model::writePort(edges[i].mask, edges[i].values);
+    if (!edges[i].sample || !rxOut)
+      continue;
+
+    bool high = spi_device_model::readMask(sampleMask) != 0;
+    uint8_t &byte = rxOut[bit / 8];
+    byte = static_cast<uint8_t>((byte << 1) | (high ? 1 : 0));
+    ++bit;
+  }
+}
+
+/**
+ * @brief Record whether the master drives a data line.
+ *
+ * @param pin Pin number
+ * @param output true if the master drives the pin
+ */
+void spi_device_model::setDirection(int pin, bool output) {
+  int line = lineOf(pin);
+  if (line >= 0)
+    masterDrives_[line] = output;
+}
+
+/**
+ * @brief Reset the pin operation counters.
+ */
+void spi_device_model::resetCounters() {
+  pinWrites_ = 0;
+  pinReads_ = 0;
+  contentions_ = 0;
+}
+
+/**
+ * @brief Start output, MSB first from the next falling edge.
+ *
+ * @param byte First output byte
+ * @param width Data lines to drive: 1 (MISO only), 2 or 4
+ */
+void spi_device_model::startOutput(uint8_t byte, unsigned width) {
+  out_ = byte;
+  outWidth_ = width;
+  bitsOut_ = 0;
+  outputActive_ = true;
+}
+
+/**
+ * @brief Map a pin number to its data line.
+ *
+ * @param pin Pin number
+ * @return int Line 0..3, or -1 if the pin is not a data line
+ */
+int spi_device_model::lineOf(int pin) const {
+  if (pin < 0)
+    return -1;
+  if (pin == pins_.mosi)
+    return 0;
+  if (pin == pins_.miso)
+    return 1;
+  if (pin == pins_.io2)
+    return 2;
+  if (pin == pins_.io3)
+    return 3;
+  return -1;
+}
+
+/**
+ * @brief Apply new levels of the bus pins in electrical order.
+ *
+ * When several pins change in one port write, CS falling is seen
+ * first and CS rising last, and MOSI settles before SCK moves, so
+ * a single write never violates setup time.
+ *
+ * @param cs New CS level
+ * @param sck New SCK level
+ * @param mosi New MOSI level
+ */
+void spi_device_model::apply(bool cs, bool sck, bool mosi) {
+  if (!cs && cs_) {
+    cs_ = false;
+    shiftIn_ = 0;
+    bitsIn_ = 0;
+    outputActive_ = false;
+    onSelect();
+  }
+
+  io_[0] = mosi;
+
+  if (sck != sck_) {
+    sck_ = sck;
+    if (!cs_) {
+      if (sck_)
+        onRisingEdge();
+      else
+        onFallingEdge();
+    }
+  }
+
+  if (cs && !cs_) {
+    cs_ = true;
+    outputActive_ = false;
+    drivenMask_ = 0;
+    onDeselect(bitsIn_ % 8 == 0);
+  }
+}
+
+/**
+ * @brief Get the level of a pin without counting the access.
+ *
+ * A data line reads what the device drives on it. Otherwise
+ * MISO is high-impedance, read as low, and the other lines
+ * read back the master's level.
+ *
+ * @param pin Pin number
+ * @return bool Pin level
+ */
+bool spi_device_model::level(int pin) const {
+  int line = lineOf(pin);
+  if (line >= 0) {
+    if (drivenMask_ & (1u << line))
+      return driven_[line];
+    return line == 1 ? false : io_[line];
+  }
+  if (pin == pins_.cs)
+    return cs_;
+  if (pin == pins_.sck)
+    return sck_;
+  return false;
+}
+
+/**
+ * @brief Sample MOSI on the SCK rising edge.
+ */
+void spi_device_model::onRisingEdge() {
+  shiftIn_ = static_cast<uint8_t>((shiftIn_ << 1) | (io_[0] ? 1 : 0));
+  if (++bitsIn_ % 8 == 0)
+    onByte(shiftIn_);
+}
+
+/**
+ * @brief Shift the next output bits to the data lines on the SCK falling
+ * edge.
+ *
+ * On a single line the bit goes to MISO. On 2 or 4 lines line k
+ * carries bit k of each group, the highest line the MSB.
+ */
+void spi_device_model::onFallingEdge() {
+  if (!outputActive_)
+    return;
+
+  if (bitsOut_ == 8) {
+    out_ = nextOutput();
+    bitsOut_ = 0;
+  }
+
+  unsigned group = (out_ >> (8 - bitsOut_ - outWidth_)) &
+                   ((1u << outWidth_) - 1);
+  bitsOut_ += outWidth_;
+
+  if (outWidth_ == 1) {
+    drivenMask_ = 0x02;
+    driven_[1] = group & 0x01;
+  } else {
+    drivenMask_ = static_cast<uint8_t>((1u << outWidth_) - 1);
+    for (unsigned k = 0; k < outWidth_; ++k)
+      driven_[k] = (group >> k) & 0x01;
+  }
+
+  for (unsigned k = 0; k < 4; ++k)
+    if ((drivenMask_ & (1u << k)) && masterDrives_[k])
+      ++contentions_;
+}
+
+/**
+ * @brief Drive a pin high on every model.
+ *
+ * @param pin Pin number
+ */
+void spi_model_bus::setHigh(int pin) {
+  for (spi_device_model *model : models_)
+    model->setHigh(pin);
+}
+
+/**
+ * @brief Drive a pin low on every model.
+ *
+ * @param pin Pin number
+ */
+void spi_model_bus::setLow(int pin) {
+  for (spi_device_model *model : models_)
+    model->setLow(pin);
+}
+
+/**
+ * @brief Read a pin as the wired OR of the models.
+ *
+ * @param pin Pin number
+ * @return bool Pin level
+ */
+bool spi_model_bus::read(int pin) {
+  bool result = false;
+  for (spi_device_model *model : models_)
+    result = model->read(pin) || result;
+  return result;
+}
+
+/**
+ * @brief Drive every pin in a mask high on every model.
+ *
+ * @param mask Bit mask of pins
+ */
+void spi_model_bus::setMask(uint32_t mask) { writePort(mask, mask); }
+
+/**
+ * @brief Drive every pin in a mask low on every model.
+ *
+ * @param mask Bit mask of pins
+ */
+void spi_model_bus::clearMask(uint32_t mask) { writePort(mask, 0); }
+
+/**
+ * @brief Set the pins in a mask on every model in one port write each.
+ *
+ * @param mask Pins to change
+ * @param values New levels for the pins in mask
+ */
+void spi_model_bus::writePort(uint32_t mask, uint32_t values) {
+  for (spi_device_model *model : models_)
+    model->writePort(mask, values);
+}
+
+/**
+ * @brief Read the pins in a mask as the wired OR of the models.
+ *
+ * @param mask Pin mask
+ * @return uint32_t Levels, bit n for pin n, zero outside mask
+ */
+uint32_t spi_model_bus::readMask(uint32_t mask) {
+  uint32_t levels = 0;
+  for (spi_device_model *model : models_)
+    levels |= model->readMask(mask);
+  return levels;
+}
+
+/**
+ * @brief Record the master's line direction on every model.
+ *
+ * @param pin Pin number
+ * @param output true if the master drives the pin
+ */
+void spi_model_bus::setDirection(int pin, bool output) {
+  for (spi_device_model *model : models_)
+    model->setDirection(pin, output);
+}
@@ -0,0 +1,75 @@
+#include "spi_timing.hpp"
+#include <algorithm>
+#include <thread>
+
+/**
+ * @brief Construct a timing policy.
+ *
+ * @param delayMode How to spend each half period
+ * @param sckHz Target SCK frequency in Hz
+ */
+spi_timing::spi_timing(mode delayMode, uint32_t sckHz) : mode_(delayMode) {
+  setFrequency(sckHz);
+}
+
+/**
+ * @brief Change the target SCK frequency.
+ *
+ * Recomputes the half period and, for the busy-wait
+ * mode, the part of it left after the clock reads.
+ *
+ * @param sckHz Target SCK frequency in Hz, 0 disables the delay
+ */
+void spi_timing::setFrequency(uint32_t sckHz) {
+  sckHz_ = sckHz;
+  if (sckHz_ == 0) {
+    half_ = std::chrono::nanoseconds(0);
+    wait_ = std::chrono::nanoseconds(0);
+    return;
+  }
+
+  half_ = std::chrono::nanoseconds(1'000'000'000ull / (2ull * sckHz_));
+  if (mode_ == mode::busy_wait) {
+    wait_ = std::max(std::chrono::nanoseconds(0), half_ - clockOverhead());
+  }
+}
+
+/**
+ * @brief Sleep for half an SCK period.
+ *
+ * Kept for hosts where burning a core is not acceptable;
+ * the real delay is bounded by the scheduler tick, not by
+ * the requested frequency.
+ */
+void spi_timing::sleepHalfPeriod() const { std::this_thread::sleep_for(half_); }
+
+/**
+ * @brief Measure the cost of reading steady_clock on this machine.
+ *
+ * Times a burst of back-to-back clock reads a few times and
+ * keeps the fastest run, which is the one least disturbed by
+ * preemption. The busy-wait subtracts this from every half
+ * period so that the loop exit is not late by one clock read.
+ *
+ * @return std::chrono::nanoseconds Cost of one steady_clock::now()
+ */
+std::chrono::nanoseconds spi_timing::clockOverhead() {
+  static const std::chrono::nanoseconds overhead = [] {
+    constexpr int reads = 1 << 12;
+    constexpr int runs = 5;
+
+    auto best = std::chrono::steady_clock::duration::max();
+    for (int run = 0; run < runs; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < reads; ++i) {
+        std::chrono::steady_clock::now();
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed);
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(best) /
+           reads;
+  }();
+  return overhead;
+}
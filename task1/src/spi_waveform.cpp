@@ -0,0 +1,65 @@
+#include "spi_waveform.hpp"
+#include <algorithm>
+
+/**
+ * @brief Construct the compiler and build the nibble table.
+ *
+ * Bit b of a nibble becomes a falling SCK edge merged with the
+ * MOSI level, then a rising SCK edge that samples MISO, exactly
+ * the order basic_chip_spi clocks a bit in.
+ *
+ * @param pinCS Chip select pin
+ * @param pinSCK SPI clock pin
+ * @param pinMOSI SPI MOSI pin
+ */
+spi_waveform::spi_waveform(int pinCS, int pinSCK, int pinMOSI)
+    : maskCS_(uint32_t{1} << (pinCS & 31)),
+      maskSCK_(uint32_t{1} << (pinSCK & 31)),
+      maskMOSI_(uint32_t{1} << (pinMOSI & 31)) {
+  for (unsigned nibble = 0; nibble < nibbles_.size(); ++nibble) {
+    for (unsigned i = 0; i < 4; ++i) {
+      bool bit = (nibble >> (3 - i)) & 0x1;
+      nibbles_[nibble][2 * i] = {maskSCK_ | maskMOSI_, bit ? maskMOSI_ : 0,
+                                 false};
+      nibbles_[nibble][2 * i + 1] = {maskSCK_, maskSCK_, true};
+    }
+  }
+}
+
+/**
+ * @brief Compile a whole transaction, replacing the previous one.
+ *
+ * The edge buffer keeps its capacity, so a driver compiling the
+ * same sizes over and over stops allocating after the first call.
+ *
+ * @param tx Bytes to send, or nullptr to send 0x00
+ * @param length Number of bytes
+ */
+void spi_waveform::compile(const uint8_t *tx, std::size_t length) {
+  edges_.resize(length * EDGES_PER_BYTE + 2);
+
+  gpio_edge *edge = edges_.data();
+  *edge++ = {maskCS_, 0, false};
+  for (std::size_t i = 0; i < length; ++i) {
+    uint8_t byte = tx ? tx[i] : 0x00;
+    const nibble_edges &high = nibbles_[byte >> 4];
+    const nibble_edges &low = nibbles_[byte & 0x0F];
+    edge = std::copy(high.begin(), high.end(), edge);
+    edge = std::copy(low.begin(), low.end(), edge);
+  }
+  // SCK back to idle before CS rises
+  *edge = {maskSCK_ | maskCS_, maskCS_, false};
+}
+
+/**
+ * @brief Count the pin writes of the waveform without port access.
+ *
+ * CS once on each side, and per bit SCK plus MOSI, then SCK.
+ *
+ * @return std::size_t Pins driven over all edges
+ */
+std::size_t spi_waveform::pinWrites() const {
+  if (edges_.empty())
+    return 0;
+  return 1 + (edges_.size() - 2) / 2 * 3 + 2;
+}
@@ -0,0 +1,188 @@
+#include "striped_memory_device.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Construct the striped device and enable deferred ready mode.
+ *
+ * Deferred mode is what lets write cycles overlap; the chips stay
+ * in it after the striped device is gone. The chip count is
+ * checked here because address mapping divides by it and the
+ * capacity has to fit the 16-bit interface.
+ *
+ * @param chips Drivers of 1 to MAX_CHIPS chips, must outlive the device
+ * @throw std::invalid_argument if the chip count is out of range or a
+ * driver is null
+ */
+striped_memory_device::striped_memory_device(std::vector<eeprom_api *> chips)
+    : chips_(std::move(chips)) {
+  if (chips_.empty() || chips_.size() > MAX_CHIPS)
+    throw std::invalid_argument("striped_memory_device: 1 to 128 chips");
+  if (std::find(chips_.begin(), chips_.end(), nullptr) != chips_.end())
+    throw std::invalid_argument("striped_memory_device: null chip driver");
+
+  for (eeprom_api *chip : chips_)
+    chip->setDeferredReady(true);
+}
+
+/**
+ * @brief Wait for the outstanding write cycles.
+ */
+striped_memory_device::~striped_memory_device() { sync(); }
+
+/**
+ * @brief Map a logical address to its chip.
+ *
+ * @param address Logical address, wrapped to the capacity
+ * @return location Chip and chip address
+ */
+striped_memory_device::location
+striped_memory_device::locate(std::size_t address) const {
+  address %= capacity();
+  std::size_t page = address / PAGE_SIZE;
+  std::size_t chipPage = page / chips_.size();
+  return {page % chips_.size(),
+          static_cast<uint16_t>(chipPage * PAGE_SIZE + address % PAGE_SIZE)};
+}
+
+/**
+ * @brief Get a chip driver, closing the read stream of another chip.
+ *
+ * The chips share the bus, so an open READ on one chip has to end
+ * before any other chip is selected.
+ *
+ * @param chip Chip index
+ * @return eeprom_api& Driver of the chip
+ */
+eeprom_api &striped_memory_device::use(std::size_t chip) {
+  if (chip != active_) {
+    chips_[active_]->endSequentialRead();
+    active_ = chip;
+  }
+  return *chips_[chip];
+}
+
+/**
+ * @brief Write a single byte to its chip.
+ *
+ * @param address Logical address
+ * @param data Byte to write
+ */
+void striped_memory_device::writeByte(uint16_t address, uint8_t data) {
+  location at = locate(address);
+  use(at.chip).writeByte(at.address, data);
+}
+
+/**
+ * @brief Read a single byte from its chip.
+ *
+ * @param address Logical address
+ * @return uint8_t Byte read
+ */
+uint8_t striped_memory_device::readByte(uint16_t address) {
+  location at = locate(address);
+  return use(at.chip).readByte(at.address);
+}
+
+/**
+ * @brief Write a buffer page by page, moving to the next chip each page.
+ *
+ * Each chip gets its page and starts the write cycle while the
+ * next chip is served; a chip is waited for only when the stripe
+ * comes back to it.
+ *
+ * @param address Logical address of the first byte
+ * @param data Pointer to data buffer
+ * @param length Number of bytes, wraps around at the capacity
+ */
+void striped_memory_device::writeBuffer(uint16_t address, const uint8_t *data,
+                                        std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    std::size_t offset = (address + done) % capacity();
+    std::size_t chunk =
+        std::min(length - done, PAGE_SIZE - offset % PAGE_SIZE);
+
+    location at = locate(offset);
+    use(at.chip).writeBuffer(at.address, data + done, chunk);
+    done += chunk;
+  }
+}
+
+/**
+ * @brief Read a buffer one chip at a time.
+ *
+ * Consecutive pages of one chip are contiguous chip addresses, so
+ * eeprom_api keeps its READ stream open across them and every
+ * chip costs one command header, not one per page.
+ *
+ * @param address Logical address of the first byte
+ * @param buffer Buffer for read data
+ * @param length Number of bytes, wraps around at the capacity
+ */
+void striped_memory_device::readBuffer(uint16_t address, uint8_t *buffer,
+                                       std::size_t length) {
+  for (std::size_t chip = 0; chip < chips_.size(); ++chip) {
+    std::size_t done = 0;
+    while (done < length) {
+      std::size_t offset = (address + done) % capacity();
+      std::size_t chunk =
+          std::min(length - done, PAGE_SIZE - offset % PAGE_SIZE);
+
+      location at = locate(offset);
+      if (at.chip == chip)
+        use(chip).readBuffer(at.address, buffer + done, chunk);
+      done += chunk;
+    }
+  }
+}
+
+/**
+ * @brief Write a single bit on its chip.
+ *
+ * @param address Logical address
+ * @param bitPosition Bit index (0-7)
+ * @param value New bit value
+ */
+void striped_memory_device::writeBit(uint16_t address, uint8_t bitPosition,
+                                     bool value) {
+  location at = locate(address);
+  use(at.chip).writeBit(at.address, bitPosition, value);
+}
+
+/**
+ * @brief Read a single bit from its chip.
+ *
+ * @param address Logical address
+ * @param bitPosition Bit index (0-7)
+ * @return true if the bit is set, false otherwise
+ */
+bool striped_memory_device::readBit(uint16_t address, uint8_t bitPosition) {
+  location at = locate(address);
+  return use(at.chip).readBit(at.address, bitPosition);
+}
+
+/**
+ * @brief Replace the masked bits of a byte on its chip.
+ *
+ * @param address Logical address
+ * @param mask Bits to update
+ * @param values New values for the masked bits
+ */
+void striped_memory_device::updateBits(uint16_t address, uint8_t mask,
+                                       uint8_t values) {
+  location at = locate(address);
+  use(at.chip).updateBits(at.address, mask, values);
+}
+
+/**
+ * @brief Wait until every chip finished its write cycle.
+ *
+ * The write cycles still run in parallel: the first chip is
+ * waited for the longest and the others are usually done by then.
+ */
+void striped_memory_device::sync() {
+  for (eeprom_api *chip : chips_)
+    chip->sync();
+}
@@ -0,0 +1,75 @@
+#include "telemetry.hpp"
+#include <bit>
+
+/**
+ * @brief Get the number of recorded samples.
+ *
+ * @return uint64_t Sum over all buckets
+ */
+uint64_t latency_histogram::total() const {
+  uint64_t sum = 0;
+  for (uint64_t count : counts)
+    sum += count;
+  return sum;
+}
+
+/**
+ * @brief Find the bucket a duration falls into.
+ *
+ * The bucket is the index of the highest set bit, which keeps
+ * recording down to one instruction on most targets.
+ *
+ * @param duration Measured latency
+ * @return std::size_t Bucket index
+ */
+std::size_t latency_histogram::bucketOf(std::chrono::nanoseconds duration) {
+  if (duration.count() <= 1)
+    return 0;
+
+  std::size_t bucket =
+      std::bit_width(static_cast<uint64_t>(duration.count())) - 1;
+  return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+/**
+ * @brief Get the smallest duration counted by a bucket.
+ *
+ * @param bucket Bucket index
+ * @return std::chrono::nanoseconds Lower bound of the bucket
+ */
+std::chrono::nanoseconds latency_histogram::lowerBound(std::size_t bucket) {
+  return bucket == 0 ? std::chrono::nanoseconds(0)
+                     : std::chrono::nanoseconds(int64_t{1} << bucket);
+}
+
+/**
+ * @brief Record one sample.
+ *
+ * @param duration Measured latency
+ */
+void telemetry_histogram::record(std::chrono::nanoseconds duration) {
+  buckets_[latency_histogram::bucketOf(duration)].add();
+}
+
+/**
+ * @brief Copy the current bucket counts.
+ *
+ * Buckets are read one by one, so a snapshot taken while calls
+ * are recorded may be off by the samples in flight.
+ *
+ * @return latency_histogram Snapshot
+ */
+latency_histogram telemetry_histogram::snapshot() const {
+  latency_histogram result;
+  for (std::size_t i = 0; i < latency_histogram::BUCKETS; ++i)
+    result.counts[i] = buckets_[i].value();
+  return result;
+}
+
+/**
+ * @brief Clear all buckets.
+ */
+void telemetry_histogram::reset() {
+  for (auto &bucket : buckets_)
+    bucket.reset();
+}
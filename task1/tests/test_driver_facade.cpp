@@ -0,0 +1,1856 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "async_memory_device.hpp"
+#include "cached_memory_device.hpp"
+#include "driver_facade.hpp"
+#include "eeprom_model.hpp"
+#include "gpio_trace.hpp"
+#include "nor_flash.hpp"
+#include "nor_flash_model.hpp"
+#include "record_store.hpp"
+#include "spi_bus.hpp"
+#include "striped_memory_device.hpp"
+
+/*
+ * Byte-level stand-in for the 25LC040A: decodes every
+ * select/deselect window into a command and keeps a
+ * 512-byte array, recording each transaction on the way.
+ * */
+class fake_eeprom_spi : public i_chip_spi_api {
+public:
+    struct transaction {
+        std::vector<uint8_t> bytes;
+    };
+
+    std::vector<transaction> log;
+    uint8_t memory[eeprom_api::MEMORY_SIZE];
+    std::chrono::microseconds writeCycle{ 0 };
+
+    fake_eeprom_spi() {
+        for (auto& byte : memory)
+            byte = 0xFF;
+    }
+
+    void select() override {
+        log.push_back({});
+    }
+
+    void deselect() override {
+        const auto& bytes = log.back().bytes;
+        if (bytes.empty() || busy())
+            return;
+
+        if (bytes[0] == 0x06)
+            wel_ = true;
+
+        if (opcode(bytes) == 0x02 && wel_ && bytes.size() > 2) {
+            busyUntil_ = std::chrono::steady_clock::now() + writeCycle;
+            uint16_t address = decodeAddress(bytes);
+            uint16_t page = address & ~(eeprom_api::PAGE_SIZE - 1);
+            for (std::size_t i = 2; i < bytes.size(); ++i) {
+                memory[page + (address + i - 2) % eeprom_api::PAGE_SIZE] =
+                    bytes[i];
+            }
+            wel_ = false;
+        }
+    }
+
+    uint8_t transfer(uint8_t data) override {
+        auto& bytes = log.back().bytes;
+        bytes.push_back(data);
+
+        if (opcode(bytes) == 0x03 && bytes.size() > 2) {
+            uint16_t address = decodeAddress(bytes);
+            return memory[(address + bytes.size() - 3) %
+                          eeprom_api::MEMORY_SIZE];
+        }
+        if (bytes[0] == 0x05 && bytes.size() == 2)
+            return busy() ? 0x03 : 0x00;
+        return 0x00;
+    }
+
+    bool busy() const {
+        return std::chrono::steady_clock::now() < busyUntil_;
+    }
+
+    std::vector<transaction> commands(uint8_t command) const {
+        std::vector<transaction> result;
+        for (const auto& t : log)
+            if (!t.bytes.empty() && opcode(t.bytes) == command)
+                result.push_back(t);
+        return result;
+    }
+
+    // A8 rides in bit 3 of the READ and WRITE opcodes
+    static uint8_t opcode(const std::vector<uint8_t>& bytes) {
+        return bytes[0] & ~0x08;
+    }
+
+    static uint16_t decodeAddress(const std::vector<uint8_t>& bytes) {
+        return ((bytes[0] & 0x08) << 5) | bytes[1];
+    }
+
+private:
+
+    bool wel_ = false;
+    std::chrono::steady_clock::time_point busyUntil_;
+};
+
+TEST(EepromApiTest, ByteRoundTrip) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x1FF, 0xA5);
+
+    ASSERT_EQ(spi.memory[0x1FF], 0xA5);
+    ASSERT_EQ(eeprom.readByte(0x1FF), 0xA5);
+}
+
+TEST(EepromApiTest, WriteBufferSplitsOnPageBoundaries) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    uint8_t data[40];
+    for (int i = 0; i < 40; ++i)
+        data[i] = i;
+
+    eeprom.writeBuffer(10, data, sizeof(data));
+
+    auto writes = spi.commands(0x02);
+    ASSERT_EQ(writes.size(), 4u);
+
+    // 10..15, 16..31, 32..47, 48..49
+    const uint16_t starts[] = { 10, 16, 32, 48 };
+    const std::size_t lengths[] = { 6, 16, 16, 2 };
+    for (std::size_t i = 0; i < writes.size(); ++i) {
+        const auto& bytes = writes[i].bytes;
+        ASSERT_EQ(fake_eeprom_spi::decodeAddress(bytes), starts[i]);
+        ASSERT_EQ(bytes.size() - 2, lengths[i]);
+    }
+
+    for (int i = 0; i < 40; ++i)
+        ASSERT_EQ(spi.memory[10 + i], i);
+}
+
+TEST(EepromApiTest, FullChipWriteCostsOneCyclePerPage) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    uint8_t data[eeprom_api::MEMORY_SIZE];
+    for (std::size_t i = 0; i < sizeof(data); ++i)
+        data[i] = i * 7;
+
+    eeprom.writeBuffer(0, data, sizeof(data));
+
+    ASSERT_EQ(spi.commands(0x02).size(),
+              eeprom_api::MEMORY_SIZE / eeprom_api::PAGE_SIZE);
+    ASSERT_EQ(spi.commands(0x06).size(),
+              eeprom_api::MEMORY_SIZE / eeprom_api::PAGE_SIZE);
+
+    for (std::size_t i = 0; i < sizeof(data); ++i)
+        ASSERT_EQ(spi.memory[i], data[i]);
+}
+
+TEST(EepromApiTest, WriteBufferWrapsAtEndOfArray) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    eeprom.writeBuffer(0x1FE, data, sizeof(data));
+
+    ASSERT_EQ(spi.commands(0x02).size(), 2u);
+    ASSERT_EQ(spi.memory[0x1FE], 1);
+    ASSERT_EQ(spi.memory[0x1FF], 2);
+    ASSERT_EQ(spi.memory[0x000], 3);
+    ASSERT_EQ(spi.memory[0x001], 4);
+}
+
+TEST(EepromApiTest, BitRoundTrip) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x10, 0x00);
+    eeprom.writeBit(0x10, 3, true);
+
+    ASSERT_EQ(spi.memory[0x10], 0x08);
+    ASSERT_TRUE(eeprom.readBit(0x10, 3));
+    ASSERT_FALSE(eeprom.readBit(0x10, 2));
+}
+
+TEST(EepromApiTest, ReadBufferUsesSingleTransaction) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    for (std::size_t i = 0; i < eeprom_api::MEMORY_SIZE; ++i)
+        spi.memory[i] = i;
+
+    uint8_t buffer[64];
+    eeprom.readBuffer(0x20, buffer, sizeof(buffer));
+
+    auto reads = spi.commands(0x03);
+    ASSERT_EQ(reads.size(), 1u);
+    ASSERT_EQ(reads[0].bytes.size(), 2 + sizeof(buffer));
+    for (std::size_t i = 0; i < sizeof(buffer); ++i)
+        ASSERT_EQ(buffer[i], static_cast<uint8_t>(0x20 + i));
+}
+
+TEST(EepromApiTest, ReadBufferWrapsAtEndOfArray) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    for (std::size_t i = 0; i < eeprom_api::MEMORY_SIZE; ++i)
+        spi.memory[i] = i ^ 0x5A;
+
+    uint8_t buffer[4];
+    eeprom.readBuffer(0x1FE, buffer, sizeof(buffer));
+
+    ASSERT_EQ(spi.commands(0x03).size(), 1u);
+    ASSERT_EQ(buffer[0], spi.memory[0x1FE]);
+    ASSERT_EQ(buffer[1], spi.memory[0x1FF]);
+    ASSERT_EQ(buffer[2], spi.memory[0x000]);
+    ASSERT_EQ(buffer[3], spi.memory[0x001]);
+
+    // the stream continues from 0x002 without a new READ
+    ASSERT_EQ(eeprom.readByte(0x002), spi.memory[0x002]);
+    ASSERT_EQ(spi.commands(0x03).size(), 1u);
+}
+
+TEST(EepromApiTest, NeighbouringReadsShareTransaction) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    spi.memory[0x40] = 0x01;
+    spi.memory[0x41] = 0x80;
+    spi.memory[0x50] = 0x33;
+
+    ASSERT_EQ(eeprom.readByte(0x40), 0x01);
+    ASSERT_TRUE(eeprom.readBit(0x41, 7));
+    ASSERT_EQ(spi.commands(0x03).size(), 1u);
+
+    // a jump restarts the stream
+    ASSERT_EQ(eeprom.readByte(0x50), 0x33);
+    ASSERT_EQ(spi.commands(0x03).size(), 2u);
+}
+
+TEST(EepromApiTest, WriteClosesOpenRead) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    ASSERT_EQ(eeprom.readByte(0x10), 0xFF);
+    eeprom.writeByte(0x11, 0x42);
+
+    // the next read must not continue the stale stream
+    ASSERT_EQ(eeprom.readByte(0x11), 0x42);
+    ASSERT_EQ(spi.commands(0x03).size(), 2u);
+}
+
+/*
+ * MISO is wired back to MOSI, so every
+ * transfer must return what it sent.
+ * Counts pin writes, optionally as
+ * a port-capable controller.
+ * */
+class loopback_gpio_driver : public i_chip_gpio_driver {
+public:
+    explicit loopback_gpio_driver(bool portAccess = false)
+        : portAccess_(portAccess) {}
+
+    void setHigh(int pin) override {
+        levels_[pin] = true;
+        ++writes;
+    }
+
+    void setLow(int pin) override {
+        levels_[pin] = false;
+        ++writes;
+    }
+
+    bool read(int) override {
+        return levels_[MOSI];
+    }
+
+    bool hasPortAccess() const override {
+        return portAccess_;
+    }
+
+    void setMask(uint32_t mask) override {
+        writePort(mask, mask);
+    }
+
+    void clearMask(uint32_t mask) override {
+        writePort(mask, 0);
+    }
+
+    void writePort(uint32_t mask, uint32_t values) override {
+        if (!portAccess_) {
+            i_chip_gpio_driver::writePort(mask, values);
+            return;
+        }
+        for (int pin = 0; pin < 4; ++pin)
+            if (mask & (1u << pin))
+                levels_[pin] = values & (1u << pin);
+        ++writes;
+    }
+
+    static constexpr int CS = 0;
+    static constexpr int SCK = 1;
+    static constexpr int MOSI = 2;
+    static constexpr int MISO = 3;
+
+    int writes = 0;
+
+private:
+    bool portAccess_;
+    bool levels_[4] = {};
+};
+
+TEST(ChipSpiApiTest, BufferTransferIsFullDuplex) {
+    loopback_gpio_driver gpio;
+    chip_spi_api spi(gpio, loopback_gpio_driver::CS, loopback_gpio_driver::SCK,
+                     loopback_gpio_driver::MOSI, loopback_gpio_driver::MISO,
+                     spi_timing(spi_timing::mode::none));
+
+    const uint8_t tx[] = { 0x00, 0xFF, 0xA5, 0x3C };
+    uint8_t rx[sizeof(tx)] = {};
+
+    spi.select();
+    spi.transfer(tx, rx, sizeof(tx));
+    spi.deselect();
+
+    for (std::size_t i = 0; i < sizeof(tx); ++i)
+        ASSERT_EQ(rx[i], tx[i]);
+}
+
+/*
+ * Loopback that counts SCK rising edges.
+ * */
+class clock_counting_gpio_driver : public loopback_gpio_driver {
+public:
+    void setHigh(int pin) override {
+        if (pin == SCK)
+            ++clocks;
+        loopback_gpio_driver::setHigh(pin);
+    }
+
+    int clocks = 0;
+};
+
+TEST(ChipSpiApiTest, SingleLineWideReadKeepsDummyCycles) {
+    clock_counting_gpio_driver gpio;
+    chip_spi_api spi(gpio, loopback_gpio_driver::CS, loopback_gpio_driver::SCK,
+                     loopback_gpio_driver::MOSI, loopback_gpio_driver::MISO,
+                     spi_timing(spi_timing::mode::none));
+
+    // four lines asked for but only MISO is wired
+    uint8_t rx[2];
+    spi.select();
+    gpio.clocks = 0;
+    spi.receiveWide(rx, sizeof(rx), 4, 6);
+    spi.deselect();
+
+    ASSERT_EQ(gpio.clocks, 6 + 16);
+}
+
+TEST(ChipSpiApiTest, DefaultBufferTransferFallsBackToBytes) {
+    fake_eeprom_spi spi;
+    i_chip_spi_api& api = spi;
+
+    const uint8_t header[] = { 0x03, 0x02 };
+    uint8_t data[3] = {};
+    spi.memory[2] = 0x11;
+    spi.memory[3] = 0x22;
+    spi.memory[4] = 0x33;
+
+    api.select();
+    api.send(header, sizeof(header));
+    api.receive(data, sizeof(data));
+    api.deselect();
+
+    ASSERT_EQ(spi.log.back().bytes.size(), 5u);
+    ASSERT_EQ(data[0], 0x11);
+    ASSERT_EQ(data[1], 0x22);
+    ASSERT_EQ(data[2], 0x33);
+}
+
+TEST(ChipSpiApiTest, PortAccessMergesClockAndData) {
+    loopback_gpio_driver perPin(false);
+    loopback_gpio_driver port(true);
+    chip_spi_api perPinSpi(perPin, loopback_gpio_driver::CS,
+                           loopback_gpio_driver::SCK,
+                           loopback_gpio_driver::MOSI,
+                           loopback_gpio_driver::MISO,
+                           spi_timing(spi_timing::mode::none));
+    chip_spi_api portSpi(port, loopback_gpio_driver::CS,
+                         loopback_gpio_driver::SCK, loopback_gpio_driver::MOSI,
+                         loopback_gpio_driver::MISO,
+                         spi_timing(spi_timing::mode::none));
+
+    const uint8_t tx[] = { 0x96, 0x0F, 0xF0, 0x55 };
+    uint8_t rx[sizeof(tx)] = {};
+
+    perPin.writes = 0;
+    perPinSpi.transfer(tx, nullptr, sizeof(tx));
+
+    port.writes = 0;
+    portSpi.transfer(tx, rx, sizeof(tx));
+
+    // two port writes per bit plus the final SCK release
+    ASSERT_EQ(port.writes, 2 * 8 * 4 + 1);
+    ASSERT_LT(port.writes, perPin.writes);
+    for (std::size_t i = 0; i < sizeof(tx); ++i)
+        ASSERT_EQ(rx[i], tx[i]);
+}
+
+TEST(SpiWaveformTest, ExpandsBytesThroughNibbleTable) {
+    spi_waveform waveform(0, 1, 2);
+    const uint8_t tx[] = { 0xA5 };
+    waveform.compile(tx, sizeof(tx));
+
+    ASSERT_EQ(waveform.size(), 2u + spi_waveform::EDGES_PER_BYTE);
+    const gpio_edge* edges = waveform.data();
+    ASSERT_EQ(edges[0].mask, 0x1u);
+    ASSERT_EQ(edges[0].values, 0x0u);
+    for (int bit = 0; bit < 8; ++bit) {
+        const gpio_edge& low = edges[1 + 2 * bit];
+        const gpio_edge& high = edges[2 + 2 * bit];
+        bool one = (0xA5 >> (7 - bit)) & 0x1;
+        ASSERT_EQ(low.mask, 0x6u);
+        ASSERT_EQ(low.values, one ? 0x4u : 0x0u);
+        ASSERT_FALSE(low.sample);
+        ASSERT_EQ(high.mask, 0x2u);
+        ASSERT_EQ(high.values, 0x2u);
+        ASSERT_TRUE(high.sample);
+    }
+    ASSERT_EQ(edges[17].mask, 0x3u);
+    ASSERT_EQ(edges[17].values, 0x1u);
+    ASSERT_EQ(waveform.pinWrites(), 1u + 8u * 3u + 2u);
+}
+
+TEST(ChipSpiApiTest, TransactionFallsBackToPortAndPinWrites) {
+    for (bool portAccess : { false, true }) {
+        loopback_gpio_driver gpio(portAccess);
+        chip_spi_api spi(gpio, loopback_gpio_driver::CS,
+                         loopback_gpio_driver::SCK, loopback_gpio_driver::MOSI,
+                         loopback_gpio_driver::MISO,
+                         spi_timing(spi_timing::mode::none));
+
+        const uint8_t tx[] = { 0x96, 0x0F, 0xF0, 0x55 };
+        uint8_t rx[sizeof(tx)] = {};
+        gpio.writes = 0;
+        spi.transaction(tx, rx, sizeof(tx));
+
+        for (std::size_t i = 0; i < sizeof(tx); ++i)
+            ASSERT_EQ(rx[i], tx[i]);
+        // one port write per edge, or one write per pin the edge drives
+        if (portAccess)
+            ASSERT_EQ(gpio.writes, 2 + 16 * 4);
+        else
+            ASSERT_EQ(gpio.writes, 3 + 24 * 4);
+    }
+}
+
+TEST(SpiTimingTest, BusyWaitTracksTargetFrequency) {
+    spi_timing timing(spi_timing::mode::busy_wait, 50'000);
+    ASSERT_LT(spi_timing::clockOverhead(), std::chrono::microseconds(10));
+
+    // 1000 half periods at 50 kHz take 10 ms
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i)
+        timing.halfPeriod();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_GE(elapsed, std::chrono::milliseconds(9));
+    ASSERT_LT(elapsed, std::chrono::milliseconds(100));
+}
+
+TEST(SpiTimingTest, NoDelayAndZeroFrequency) {
+    spi_timing none(spi_timing::mode::none);
+    spi_timing zero(spi_timing::mode::busy_wait, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100000; ++i) {
+        none.halfPeriod();
+        zero.halfPeriod();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_LT(elapsed, std::chrono::milliseconds(50));
+}
+
+TEST(BasicChipSpiTest, StaticPinsMatchTypeErasedWrapper) {
+    using pins = static_spi_pins<loopback_gpio_driver::CS,
+                                 loopback_gpio_driver::SCK,
+                                 loopback_gpio_driver::MOSI,
+                                 loopback_gpio_driver::MISO>;
+
+    loopback_gpio_driver gpio(true);
+    basic_chip_spi<loopback_gpio_driver, pins, spi_no_delay> spi(gpio);
+
+    const uint8_t tx[] = { 0x01, 0x80, 0x7E, 0xC3 };
+    uint8_t rx[sizeof(tx)] = {};
+
+    gpio.writes = 0;
+    spi.select();
+    spi.transfer(tx, rx, sizeof(tx));
+    spi.deselect();
+
+    ASSERT_EQ(gpio.writes, 1 + 2 * 8 * 4 + 1 + 1);
+    for (std::size_t i = 0; i < sizeof(tx); ++i)
+        ASSERT_EQ(rx[i], tx[i]);
+}
+
+TEST(CachedMemoryDeviceTest, ReadsComeFromRam) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    cached_memory_device cache(eeprom);
+    spi.memory[0x80] = 0x5A;
+
+    ASSERT_EQ(cache.readByte(0x80), 0x5A);
+    ASSERT_TRUE(cache.readBit(0x80, 1));
+
+    uint8_t buffer[32];
+    cache.readBuffer(0x1F0, buffer, sizeof(buffer));
+
+    // one sequential read of the whole device at first access
+    ASSERT_EQ(spi.commands(0x03).size(), 1u);
+}
+
+TEST(CachedMemoryDeviceTest, FlushWritesOnlyDirtyPages) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    cached_memory_device cache(eeprom);
+
+    // thousands of updates on pages 2, 3 and 10
+    for (int i = 0; i < 1000; ++i) {
+        cache.writeByte(0x20 + i % 32, i);
+        cache.writeBit(0xA5, i % 8, i & 1);
+    }
+    ASSERT_EQ(spi.commands(0x02).size(), 0u);
+    ASSERT_EQ(cache.dirtyPages(), 3u);
+
+    cache.flush();
+
+    // pages 2-3 go out as one buffer, page 10 on its own
+    ASSERT_EQ(spi.commands(0x02).size(), 3u);
+    ASSERT_EQ(cache.dirtyPages(), 0u);
+    for (int i = 968; i < 1000; ++i)
+        ASSERT_EQ(spi.memory[0x20 + i % 32], static_cast<uint8_t>(i));
+    ASSERT_EQ(spi.memory[0xA5], 0xAA);
+
+    cache.flush();
+    ASSERT_EQ(spi.commands(0x02).size(), 3u);
+}
+
+TEST(CachedMemoryDeviceTest, ThresholdAndDestructorFlush) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    {
+        cached_memory_device cache(eeprom, 2);
+
+        cache.writeByte(0x05, 1);
+        ASSERT_EQ(spi.commands(0x02).size(), 0u);
+
+        cache.writeByte(0x10, 2);
+        ASSERT_EQ(spi.commands(0x02).size(), 2u);
+
+        // rewriting the same value does not dirty the page
+        cache.writeByte(0x10, 2);
+        ASSERT_EQ(cache.dirtyPages(), 0u);
+
+        // wraps into page 0 and stays below the threshold
+        const uint8_t tail[] = { 7, 8, 9 };
+        cache.writeBuffer(0x000, tail + 1, 2);
+        ASSERT_EQ(cache.dirtyPages(), 1u);
+        cache.writeBuffer(0x1FF, tail, sizeof(tail));
+        ASSERT_EQ(cache.dirtyPages(), 0u);
+        ASSERT_EQ(spi.commands(0x02).size(), 4u);
+
+        cache.writeByte(0x40, 3);
+        ASSERT_EQ(cache.dirtyPages(), 1u);
+    }
+    ASSERT_EQ(spi.memory[0x05], 1);
+    ASSERT_EQ(spi.memory[0x40], 3);
+    ASSERT_EQ(spi.memory[0x10], 2);
+    ASSERT_EQ(spi.memory[0x1FF], 7);
+    ASSERT_EQ(spi.memory[0x000], 8);
+    ASSERT_EQ(spi.memory[0x001], 9);
+}
+
+TEST(EepromApiTest, SkipUnchangedAvoidsWriteCycles) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    eeprom.setSkipUnchanged(true);
+
+    uint8_t data[48];
+    for (std::size_t i = 0; i < sizeof(data); ++i)
+        data[i] = spi.memory[0x30 + i];
+    data[20] = 0x00;
+    data[23] = 0x01;
+
+    // three pages, only the middle one differs, in bytes 4..7
+    eeprom.writeBuffer(0x30, data, sizeof(data));
+
+    auto writes = spi.commands(0x02);
+    ASSERT_EQ(writes.size(), 1u);
+    ASSERT_EQ(writes[0].bytes[1], 0x44);
+    ASSERT_EQ(writes[0].bytes.size(), 2u + 4u);
+    ASSERT_EQ(eeprom.writeStats().writeCycles, 1u);
+    ASSERT_EQ(eeprom.writeStats().skippedCycles, 2u);
+    ASSERT_EQ(eeprom.writeStats().bytesProgrammed, 4u);
+    ASSERT_EQ(spi.memory[0x44], 0x00);
+    ASSERT_EQ(spi.memory[0x47], 0x01);
+
+    // unchanged byte and bit cost nothing
+    eeprom.writeByte(0x44, 0x00);
+    eeprom.writeBit(0x47, 0, true);
+    ASSERT_EQ(spi.commands(0x02).size(), 1u);
+    ASSERT_EQ(eeprom.writeStats().skippedCycles, 4u);
+
+    eeprom.writeBit(0x47, 0, false);
+    ASSERT_EQ(spi.commands(0x02).size(), 2u);
+    ASSERT_EQ(spi.memory[0x47], 0x00);
+
+    eeprom.resetWriteStats();
+    ASSERT_EQ(eeprom.writeStats().writeCycles, 0u);
+}
+
+TEST(EepromApiTest, WritesAlwaysProgramByDefault) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x00, 0xFF);
+    eeprom.writeBit(0x00, 0, true);
+
+    ASSERT_EQ(spi.commands(0x02).size(), 2u);
+    ASSERT_EQ(eeprom.writeStats().writeCycles, 2u);
+    ASSERT_EQ(eeprom.writeStats().skippedCycles, 0u);
+}
+
+TEST(EepromApiTest, UpdateBitsIsOneReadModifyWrite) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    spi.memory[0x33] = 0x0F;
+
+    eeprom.updateBits(0x33, 0x3C, 0xF0);
+
+    ASSERT_EQ(spi.memory[0x33], 0x33);
+    ASSERT_EQ(spi.commands(0x03).size(), 1u);
+    ASSERT_EQ(spi.commands(0x02).size(), 1u);
+}
+
+TEST(EepromApiTest, BatchedBitsCostOneWritePerPage) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    for (std::size_t i = 0; i < eeprom_api::MEMORY_SIZE; ++i)
+        spi.memory[i] = 0x00;
+
+    std::vector<bit_update> updates;
+    for (uint8_t bit = 0; bit < 8; ++bit)
+        updates.push_back({ 0x12, bit, true });
+    updates.push_back({ 0x1E, 7, true });
+    updates.push_back({ 0x12, 0, false }); // later assignment wins
+    updates.push_back({ 0x41, 3, true });
+    updates.push_back({ 0x241, 4, true }); // wraps to 0x041
+
+    eeprom.updateBits(updates.data(), updates.size());
+
+    ASSERT_EQ(spi.commands(0x02).size(), 2u);
+    ASSERT_EQ(spi.commands(0x03).size(), 2u);
+    ASSERT_EQ(spi.memory[0x12], 0xFE);
+    ASSERT_EQ(spi.memory[0x1E], 0x80);
+    ASSERT_EQ(spi.memory[0x41], 0x18);
+}
+
+TEST(CachedMemoryDeviceTest, DefaultUpdateBitsGoesThroughImage) {
+    fake_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    cached_memory_device cache(eeprom);
+
+    const bit_update updates[] = { { 0x00, 1, false }, { 0x100, 7, false } };
+    cache.updateBits(updates, 2);
+    cache.updateBits(0x01, 0xF0, 0x00);
+    ASSERT_EQ(cache.dirtyPages(), 2u);
+
+    cache.flush();
+    ASSERT_EQ(spi.memory[0x00], 0xFD);
+    ASSERT_EQ(spi.memory[0x01], 0x0F);
+    ASSERT_EQ(spi.memory[0x100], 0x7F);
+}
+
+/*
+ * Blocks every select() while the test holds the
+ * gate, to pin the async worker inside a request.
+ * */
+class gated_eeprom_spi : public fake_eeprom_spi {
+public:
+    void select() override {
+        ++waiting;
+        std::lock_guard<std::mutex> lock(gate);
+        --waiting;
+        fake_eeprom_spi::select();
+    }
+
+    void waitForWorker() {
+        while (waiting == 0)
+            std::this_thread::yield();
+    }
+
+    std::mutex gate;
+    std::atomic<int> waiting{ 0 };
+};
+
+TEST(AsyncMemoryDeviceTest, MergesQueuedWritesIntoPages) {
+    gated_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    async_memory_device device(eeprom);
+
+    spi.gate.lock();
+    auto first = device.writeByte(0x00, 0xAA);
+    spi.waitForWorker();
+
+    // queued while the worker is busy: 32 adjacent single bytes
+    std::vector<std::future<void>> pending;
+    for (int i = 0; i < 32; ++i)
+        pending.push_back(device.writeByte(0x20 + i, i));
+    int callbacks = 0;
+    const uint8_t tail[] = { 0xDE, 0xAD };
+    device.writeBuffer(0x40, tail, sizeof(tail), [&] { ++callbacks; });
+    spi.gate.unlock();
+
+    device.drain();
+    first.get();
+    for (auto& done : pending)
+        ASSERT_EQ(done.wait_for(std::chrono::seconds(0)),
+                  std::future_status::ready);
+
+    ASSERT_EQ(callbacks, 1);
+    ASSERT_EQ(device.deviceWrites(), 2u);
+    // the first byte, then 0x20..0x41 as three pages
+    ASSERT_EQ(spi.commands(0x02).size(), 4u);
+    ASSERT_EQ(spi.memory[0x00], 0xAA);
+    for (int i = 0; i < 32; ++i)
+        ASSERT_EQ(spi.memory[0x20 + i], i);
+    ASSERT_EQ(spi.memory[0x40], 0xDE);
+    ASSERT_EQ(spi.memory[0x41], 0xAD);
+}
+
+TEST(AsyncMemoryDeviceTest, ReadsSeePendingWrites) {
+    gated_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    async_memory_device device(eeprom);
+
+    spi.gate.lock();
+    device.writeByte(0x100, 0x01);
+    spi.waitForWorker();
+
+    const uint8_t data[] = { 0x11, 0x22, 0x33 };
+    device.writeBuffer(0x101, data, sizeof(data));
+    device.writeByte(0x102, 0x44);
+
+    uint8_t buffer[4] = {};
+    std::thread reader([&] { device.readBuffer(0x100, buffer, 4); });
+    // give the reader time to queue up behind the blocked worker
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    spi.gate.unlock();
+    reader.join();
+
+    ASSERT_EQ(buffer[0], 0x01);
+    ASSERT_EQ(buffer[1], 0x11);
+    ASSERT_EQ(buffer[2], 0x44);
+    ASSERT_EQ(buffer[3], 0x33);
+
+    device.drain();
+    ASSERT_EQ(device.readByte(0x102), 0x44);
+    ASSERT_EQ(spi.memory[0x103], 0x33);
+}
+
+TEST(AsyncMemoryDeviceTest, WritesWrapAtTheEndOfTheDevice) {
+    gated_eeprom_spi spi;
+    eeprom_api eeprom(spi);
+    async_memory_device device(eeprom);
+
+    spi.gate.lock();
+    device.writeByte(0x100, 0x01);
+    spi.waitForWorker();
+
+    // 0x1FE, 0x1FF, then 0x000, 0x001
+    const uint8_t data[] = { 0x11, 0x22, 0x33, 0x44 };
+    device.writeBuffer(0x1FE, data, sizeof(data));
+    device.writeByte(0x001, 0x55);
+
+    uint8_t buffer[2] = {};
+    std::thread reader([&] { device.readBuffer(0x000, buffer, 2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    spi.gate.unlock();
+    reader.join();
+
+    ASSERT_EQ(buffer[0], 0x33);
+    ASSERT_EQ(buffer[1], 0x55);
+
+    // the later byte at 0x001 still wins once both are merged
+    device.drain();
+    ASSERT_EQ(spi.memory[0x1FE], 0x11);
+    ASSERT_EQ(spi.memory[0x1FF], 0x22);
+    ASSERT_EQ(spi.memory[0x000], 0x33);
+    ASSERT_EQ(spi.memory[0x001], 0x55);
+}
+
+TEST(EepromApiTest, ReadyWaitBlocksWritesByDefault) {
+    fake_eeprom_spi spi;
+    spi.writeCycle = std::chrono::milliseconds(2);
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x00, 0x12);
+    eeprom.writeByte(0x01, 0x34);
+
+    ASSERT_FALSE(spi.busy());
+    ASSERT_EQ(spi.memory[0x00], 0x12);
+    ASSERT_EQ(spi.memory[0x01], 0x34);
+    ASSERT_EQ(eeprom.readyStats().waits, 2u);
+    ASSERT_GE(eeprom.readyStats().waited, std::chrono::milliseconds(3));
+    ASSERT_EQ(eeprom.readyStats().hidden.count(), 0);
+}
+
+TEST(EepromApiTest, DeferredReadyOverlapsWriteCycle) {
+    fake_eeprom_spi spi;
+    spi.writeCycle = std::chrono::milliseconds(2);
+    eeprom_api eeprom(spi);
+    eeprom.setDeferredReady(true);
+
+    eeprom.writeByte(0x10, 0x55);
+    ASSERT_TRUE(spi.busy());
+    ASSERT_EQ(eeprom.readyStats().waits, 0u);
+
+    // caller works elsewhere for longer than tWC
+    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+
+    ASSERT_EQ(eeprom.readByte(0x10), 0x55);
+    ASSERT_EQ(eeprom.readyStats().waits, 1u);
+    ASSERT_EQ(eeprom.readyStats().polls, 1u);
+    ASSERT_GE(eeprom.readyStats().hidden, std::chrono::milliseconds(2));
+
+    // back-to-back writes still wait for each other
+    const uint8_t data[] = { 1, 2, 3 };
+    eeprom.writeBuffer(0x1F, data, sizeof(data));
+    ASSERT_GE(eeprom.readyStats().waited, std::chrono::milliseconds(1));
+    eeprom.sync();
+    ASSERT_FALSE(spi.busy());
+    ASSERT_EQ(spi.memory[0x1F], 1);
+    ASSERT_EQ(spi.memory[0x20], 2);
+    ASSERT_EQ(spi.memory[0x21], 3);
+}
+
+static eeprom_model_config instantModel(bool portAccess = true) {
+    eeprom_model_config config;
+    config.writeCycle = std::chrono::microseconds(0);
+    config.portAccess = portAccess;
+    return config;
+}
+
+TEST(EepromModelTest, RoundTripOnBothPinPaths) {
+    for (bool portAccess : { false, true }) {
+        eeprom_model model(instantModel(portAccess));
+        chip_spi_api spi(model, 0, 1, 2, 3,
+                         spi_timing(spi_timing::mode::none));
+        eeprom_api eeprom(spi);
+
+        std::vector<uint8_t> data(300);
+        for (std::size_t i = 0; i < data.size(); ++i)
+            data[i] = static_cast<uint8_t>(i * 7 + 3);
+
+        // crosses pages, the A8 boundary and the end of memory
+        eeprom.writeBuffer(0x180, data.data(), data.size());
+
+        std::vector<uint8_t> back(data.size());
+        eeprom.readBuffer(0x180, back.data(), back.size());
+        ASSERT_EQ(back, data);
+        for (std::size_t i = 0; i < data.size(); ++i)
+            ASSERT_EQ(model.memory()[(0x180 + i) % 512], data[i]);
+        ASSERT_EQ(model.writeCycles(), (300u + 15u) / 16u);
+    }
+}
+
+TEST(EepromModelTest, TransactionIsReplayedAsOneWaveform) {
+    eeprom_model model(instantModel(false));
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    model.resetCounters();
+
+    const uint8_t wren = 0x06;
+    spi.transaction(&wren, nullptr, 1);
+    ASSERT_EQ(model.status(), eeprom_model::STATUS_WEL);
+
+    const uint8_t rdsr[] = { 0x05, 0x00 };
+    uint8_t rx[2] = {};
+    spi.transaction(rdsr, rx, sizeof(rdsr));
+    ASSERT_EQ(rx[1], eeprom_model::STATUS_WEL);
+
+    // one port write per edge and one read per bit, pins wired or not
+    ASSERT_EQ(model.pinWrites(), (2u + 16u) + (2u + 32u));
+    ASSERT_EQ(model.pinReads(), 16u);
+}
+
+TEST(EepromModelTest, CycleEstimateConvergesToWriteCycle) {
+    eeprom_model_config config = instantModel();
+    config.writeCycle = std::chrono::milliseconds(1);
+    eeprom_model model(config);
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    eeprom_api eeprom(spi);
+
+    // starts at half of the 5 ms datasheet tWC
+    for (int i = 0; i < 40; ++i)
+        eeprom.writeByte(static_cast<uint16_t>(16 * (i % 32)), i);
+
+    ASSERT_GT(eeprom.cycleEstimate(), std::chrono::microseconds(700));
+    ASSERT_LT(eeprom.cycleEstimate(), std::chrono::microseconds(1500));
+
+    eeprom.resetReadyStats();
+    for (int i = 0; i < 10; ++i)
+        eeprom.writeByte(static_cast<uint16_t>(16 * i), 0x5A);
+    ASSERT_LT(eeprom.readyStats().waited, std::chrono::milliseconds(20));
+}
+
+TEST(EepromModelTest, A8TravelsInOpcode) {
+    eeprom_model model(instantModel());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x100, 0x5A);
+
+    ASSERT_EQ(model.memory()[0x100], 0x5A);
+    ASSERT_EQ(model.memory()[0x000], 0xFF);
+    ASSERT_EQ(eeprom.readByte(0x100), 0x5A);
+}
+
+TEST(EepromModelTest, WriteNeedsLatchAndWrapsInPage) {
+    eeprom_model model(instantModel());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    const uint8_t frame[] = { 0x02, 0x1E, 0xA1, 0xA2, 0xA3, 0xA4 };
+
+    spi.select();
+    spi.send(frame, sizeof(frame));
+    spi.deselect();
+    ASSERT_EQ(model.memory()[0x1E], 0xFF);
+    ASSERT_EQ(model.writeCycles(), 0u);
+
+    spi.select();
+    spi.transfer(0x06);
+    spi.deselect();
+    ASSERT_EQ(model.status(), eeprom_model::STATUS_WEL);
+
+    spi.select();
+    spi.send(frame, sizeof(frame));
+    spi.deselect();
+
+    // 0x1E, 0x1F, then back to the start of the page
+    ASSERT_EQ(model.memory()[0x1E], 0xA1);
+    ASSERT_EQ(model.memory()[0x1F], 0xA2);
+    ASSERT_EQ(model.memory()[0x10], 0xA3);
+    ASSERT_EQ(model.memory()[0x11], 0xA4);
+    ASSERT_EQ(model.memory()[0x20], 0xFF);
+    ASSERT_EQ(model.status(), 0x00);
+}
+
+TEST(EepromModelTest, BusyCycleReportsWipAndIgnoresCommands) {
+    eeprom_model_config config;
+    config.writeCycle = std::chrono::milliseconds(20);
+    eeprom_model model(config);
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    model.memory()[0x40] = 0x77;
+
+    const uint8_t frame[] = { 0x02, 0x40, 0x12 };
+    spi.select();
+    spi.transfer(0x06);
+    spi.deselect();
+    spi.select();
+    spi.send(frame, sizeof(frame));
+    spi.deselect();
+
+    spi.select();
+    spi.transfer(0x05);
+    uint8_t status = spi.transfer(0x00);
+    spi.deselect();
+    ASSERT_EQ(status, eeprom_model::STATUS_WIP | eeprom_model::STATUS_WEL);
+
+    // READ is ignored while busy, MISO stays released
+    spi.select();
+    spi.transfer(0x03);
+    spi.transfer(0x40);
+    ASSERT_EQ(spi.transfer(0x00), 0x00);
+    spi.deselect();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    ASSERT_FALSE(model.busy());
+    ASSERT_EQ(model.status(), 0x00);
+    ASSERT_EQ(model.memory()[0x40], 0x12);
+}
+
+TEST(EepromModelTest, ApiWaitsOutRealWriteCycle) {
+    eeprom_model_config config;
+    config.writeCycle = std::chrono::milliseconds(1);
+    eeprom_model model(config);
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    eeprom_api eeprom(spi);
+
+    const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                             13, 14, 15, 16, 17, 18, 19, 20 };
+    eeprom.writeBuffer(0x08, data, sizeof(data));
+
+    uint8_t back[sizeof(data)] = {};
+    eeprom.readBuffer(0x08, back, sizeof(back));
+    for (std::size_t i = 0; i < sizeof(data); ++i)
+        ASSERT_EQ(back[i], data[i]);
+    ASSERT_EQ(model.writeCycles(), 2u);
+    ASSERT_GE(eeprom.readyStats().polls, 2u);
+}
+
+TEST(EepromModelTest, BlockProtectDropsWrites) {
+    eeprom_model model(instantModel());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    eeprom_api eeprom(spi);
+
+    // WRSR with BP1:BP0 = 01 protects 0x180..0x1FF
+    const uint8_t wrsr[] = { 0x01, 0x04 };
+    spi.select();
+    spi.transfer(0x06);
+    spi.deselect();
+    spi.select();
+    spi.send(wrsr, sizeof(wrsr));
+    spi.deselect();
+    ASSERT_EQ(model.status(), 0x04);
+
+    eeprom.writeByte(0x17F, 0x01);
+    eeprom.writeByte(0x180, 0x02);
+
+    ASSERT_EQ(model.memory()[0x17F], 0x01);
+    ASSERT_EQ(model.memory()[0x180], 0xFF);
+}
+
+TEST(TelemetryTest, HistogramBucketsAreLog2) {
+    using std::chrono::nanoseconds;
+
+    ASSERT_EQ(latency_histogram::bucketOf(nanoseconds(0)), 0u);
+    ASSERT_EQ(latency_histogram::bucketOf(nanoseconds(1)), 0u);
+    ASSERT_EQ(latency_histogram::bucketOf(nanoseconds(2)), 1u);
+    ASSERT_EQ(latency_histogram::bucketOf(nanoseconds(1023)), 9u);
+    ASSERT_EQ(latency_histogram::bucketOf(nanoseconds(1024)), 10u);
+    ASSERT_EQ(latency_histogram::bucketOf(nanoseconds(int64_t{1} << 40)),
+              latency_histogram::BUCKETS - 1);
+    ASSERT_EQ(latency_histogram::lowerBound(10), nanoseconds(1024));
+
+    telemetry_histogram histogram;
+    histogram.record(nanoseconds(1500));
+    histogram.record(nanoseconds(1600));
+    ASSERT_EQ(histogram.snapshot().counts[10], 2u);
+    ASSERT_EQ(histogram.snapshot().total(), 2u);
+    histogram.reset();
+    ASSERT_EQ(histogram.snapshot().total(), 0u);
+}
+
+#if DRIVER_FACADE_TELEMETRY
+TEST(TelemetryTest, SpiCountsTransactionsBytesAndToggles) {
+    eeprom_model model(instantModel());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    spi.resetTelemetry();
+    model.resetCounters();
+
+    const uint8_t tx[] = { 0x05, 0x00, 0x00 };
+    spi.select();
+    spi.send(tx, sizeof(tx));
+    spi.deselect();
+
+    spi_telemetry t = spi.telemetry();
+    ASSERT_EQ(t.transactions, 1u);
+    ASSERT_EQ(t.bytes, 3u);
+    ASSERT_EQ(t.gpioToggles, model.pinWrites());
+
+    spi.resetTelemetry();
+    ASSERT_EQ(spi.telemetry().gpioToggles, 0u);
+}
+
+TEST(TelemetryTest, EepromCountsOuterCalls) {
+    eeprom_model_config config;
+    config.writeCycle = std::chrono::microseconds(200);
+    eeprom_model model(config);
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x10, 0x01);
+    eeprom.writeBit(0x10, 7, true);
+    uint8_t buffer[4];
+    eeprom.readBuffer(0x10, buffer, sizeof(buffer));
+
+    eeprom_telemetry t = eeprom.telemetry();
+    ASSERT_EQ(t.of(eeprom_call::writeByte).total(), 1u);
+    ASSERT_EQ(t.of(eeprom_call::writeBit).total(), 1u);
+    ASSERT_EQ(t.of(eeprom_call::readBuffer).total(), 1u);
+    // writeBit goes through updateBits and readByte internally
+    ASSERT_EQ(t.of(eeprom_call::updateBits).total(), 0u);
+    ASSERT_EQ(t.of(eeprom_call::readByte).total(), 0u);
+
+    eeprom.resetTelemetry();
+    t = eeprom.telemetry();
+    ASSERT_EQ(t.of(eeprom_call::writeByte).total(), 0u);
+}
+#endif
+
+static nor_flash_model_config smallNor() {
+    nor_flash_model_config config;
+    config.capacity = 1024 * 1024;
+    config.pageProgram = std::chrono::microseconds(0);
+    config.sectorErase = std::chrono::microseconds(0);
+    config.block32Erase = std::chrono::microseconds(0);
+    config.block64Erase = std::chrono::microseconds(0);
+    return config;
+}
+
+TEST(NorFlashTest, ReadsJedecId) {
+    nor_flash_model model(smallNor());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    ASSERT_EQ(flash.readJedecId(), 0xEF4018u);
+}
+
+TEST(NorFlashTest, ClearingBitsProgramsInPlace) {
+    nor_flash_model model(smallNor());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    // many small writes to one sector land in one commit
+    for (uint32_t i = 0; i < 64; ++i)
+        flash.writeByte(0x12000 + 2 * i, static_cast<uint8_t>(i));
+    ASSERT_EQ(model.pagePrograms(), 0u);
+    flash.flush();
+
+    ASSERT_EQ(model.erases(), 0u);
+    ASSERT_EQ(model.pagePrograms(), 1u);
+    ASSERT_EQ(flash.stats().inPlaceCommits, 1u);
+    for (uint32_t i = 0; i < 64; ++i)
+        ASSERT_EQ(model.memory()[0x12000 + 2 * i], i);
+
+    // 0x3F -> 0x0F only clears bits
+    flash.writeByte(0x12000 + 2 * 63, 0x0F);
+    flash.flush();
+    ASSERT_EQ(model.erases(), 0u);
+    ASSERT_EQ(model.pagePrograms(), 2u);
+    ASSERT_EQ(flash.stats().bytesProgrammed, 127u + 1u);
+}
+
+TEST(NorFlashTest, SettingBitsErasesAndRestoresSector) {
+    nor_flash_model model(smallNor());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    const uint8_t data[] = { 0x00, 0x11, 0x22, 0x33 };
+    flash.writeBuffer(0x3000, data, sizeof(data));
+    flash.writeBuffer(0x3F00, data, sizeof(data));
+    flash.flush();
+    ASSERT_EQ(model.erases(), 0u);
+
+    flash.writeBit(0x3001, 7, true);
+    flash.flush();
+
+    ASSERT_EQ(model.erases(), 1u);
+    ASSERT_EQ(flash.stats().erases, 1u);
+    ASSERT_EQ(model.memory()[0x3000], 0x00);
+    ASSERT_EQ(model.memory()[0x3001], 0x91);
+    ASSERT_EQ(model.memory()[0x3F03], 0x33);
+    ASSERT_EQ(model.memory()[0x3004], 0xFF);
+    // only the two non-blank pages are programmed back
+    ASSERT_EQ(model.pagePrograms(), 4u);
+}
+
+TEST(NorFlashTest, ReadsSeeBufferedWritesAcrossSectors) {
+    nor_flash_model model(smallNor());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+
+    std::vector<uint8_t> data(6000);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 13);
+
+    {
+        nor_flash_api flash(spi, 1024 * 1024);
+        flash.writeBuffer(0x7F0, data.data(), data.size());
+
+        // the last sector is still buffered
+        std::vector<uint8_t> back(data.size());
+        flash.readBuffer(0x7F0, back.data(), back.size());
+        ASSERT_EQ(back, data);
+        ASSERT_EQ(flash.readByte(0x7F0 + 5999), data[5999]);
+    }
+
+    for (std::size_t i = 0; i < data.size(); ++i)
+        ASSERT_EQ(model.memory()[0x7F0 + i], data[i]);
+}
+
+TEST(NorFlashTest, RawEraseWaitsForBusy) {
+    nor_flash_model_config config = smallNor();
+    config.block64Erase = std::chrono::milliseconds(3);
+    nor_flash_model model(config);
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    const uint8_t data[] = { 0xA5, 0x5A };
+    flash.programPage(0x200FF, data, 1);
+    ASSERT_EQ(model.memory()[0x200FF], 0xA5);
+
+    auto begin = std::chrono::steady_clock::now();
+    flash.eraseBlock64(0x2ABCD);
+    ASSERT_GE(std::chrono::steady_clock::now() - begin,
+              std::chrono::milliseconds(3));
+    ASSERT_FALSE(model.busy());
+    ASSERT_EQ(model.memory()[0x200FF], 0xFF);
+    ASSERT_EQ(flash.readByte(0x200FF), 0xFF);
+}
+
+TEST(NorFlashTest, ProgramPageStopsAtThePageEnd) {
+    nor_flash_model model(smallNor());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    std::vector<uint8_t> data(600, 0x3C);
+    ASSERT_EQ(flash.programPage(0x1F0, data.data(), data.size()), 0x10u);
+    ASSERT_EQ(model.memory()[0x1EF], 0xFF);
+    ASSERT_EQ(model.memory()[0x1F0], 0x3C);
+    ASSERT_EQ(model.memory()[0x1FF], 0x3C);
+    ASSERT_EQ(model.memory()[0x100], 0xFF);
+    ASSERT_EQ(model.memory()[0x200], 0xFF);
+
+    ASSERT_EQ(flash.programPage(0x400, data.data(), data.size()),
+              nor_flash_api::PAGE_SIZE);
+    ASSERT_EQ(model.memory()[0x4FF], 0x3C);
+    ASSERT_EQ(model.memory()[0x500], 0xFF);
+}
+
+static nor_flash_model_config quadWiredNor() {
+    nor_flash_model_config config = smallNor();
+    config.statusWrite = std::chrono::microseconds(0);
+    config.pins.io2 = 4;
+    config.pins.io3 = 5;
+    return config;
+}
+
+TEST(NorFlashTest, WideReadsMatchSingleLine) {
+    nor_flash_model model(quadWiredNor());
+    for (std::size_t i = 0; i < 4096; ++i)
+        model.memory()[0x5000 + i] = static_cast<uint8_t>(i * 31 + 7);
+
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    spi.setDataLines(4, 4, 5);
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    // QE is clear out of the box, so two lines is the widest
+    ASSERT_EQ(flash.readMode(), nor_read_mode::dual);
+    flash.enableQuad();
+    ASSERT_EQ(flash.readMode(), nor_read_mode::quad);
+    ASSERT_TRUE(model.status2() & nor_flash_model::STATUS2_QE);
+
+    const nor_read_mode modes[] = { nor_read_mode::standard,
+                                    nor_read_mode::fast,
+                                    nor_read_mode::dual,
+                                    nor_read_mode::quad };
+    uint64_t writes[4];
+    for (int m = 0; m < 4; ++m) {
+        flash.setReadMode(modes[m]);
+        model.resetCounters();
+
+        std::vector<uint8_t> back(4096);
+        flash.readBuffer(0x5000, back.data(), back.size());
+
+        writes[m] = model.pinWrites();
+        ASSERT_EQ(model.contentions(), 0u);
+        for (std::size_t i = 0; i < back.size(); ++i)
+            ASSERT_EQ(back[i], model.memory()[0x5000 + i]);
+    }
+
+    // SCK edges dominate: quad needs about a quarter of single-line
+    ASSERT_LT(writes[3] * 3, writes[0]);
+    ASSERT_LT(writes[2] * 3, writes[0] * 2);
+}
+
+TEST(NorFlashTest, QuadReadIgnoredWithoutQe) {
+    nor_flash_model model(quadWiredNor());
+    model.memory()[0x100] = 0x5A;
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    spi.setDataLines(4, 4, 5);
+    nor_flash_api flash(spi, 1024 * 1024);
+
+    flash.setReadMode(nor_read_mode::quad);
+    ASSERT_NE(flash.readByte(0x100), 0x5A);
+
+    flash.setReadMode(nor_read_mode::dual);
+    ASSERT_EQ(flash.readByte(0x100), 0x5A);
+    ASSERT_EQ(model.contentions(), 0u);
+}
+
+struct eeprom_bus_rig {
+    spi_model_bus wires;
+    std::vector<std::unique_ptr<eeprom_model>> models;
+    spi_bus bus;
+    std::vector<std::unique_ptr<eeprom_api>> chips;
+
+    // CS of chip k on pin 4 + k, SCK/MOSI/MISO shared on 1/2/3
+    eeprom_bus_rig(std::size_t count, std::chrono::microseconds writeCycle)
+        : bus(wires, 1, 2, 3, spi_timing(spi_timing::mode::none)) {
+        for (std::size_t k = 0; k < count; ++k) {
+            eeprom_model_config config = instantModel();
+            config.writeCycle = writeCycle;
+            config.pins.cs = static_cast<int>(4 + k);
+            models.push_back(std::make_unique<eeprom_model>(config));
+            wires.attach(*models.back());
+        }
+        for (std::size_t k = 0; k < count; ++k)
+            chips.push_back(std::make_unique<eeprom_api>(
+                bus.attach(static_cast<int>(4 + k))));
+    }
+
+    std::vector<eeprom_api *> drivers() {
+        std::vector<eeprom_api *> result;
+        for (auto &chip : chips)
+            result.push_back(chip.get());
+        return result;
+    }
+};
+
+TEST(SpiBusTest, ChipsShareLinesWithoutCrosstalk) {
+    eeprom_bus_rig rig(2, std::chrono::microseconds(0));
+    const uint8_t first[] = { 1, 2, 3, 4 };
+    const uint8_t second[] = { 9, 8, 7, 6 };
+
+    rig.chips[0]->writeBuffer(0x1FE, first, sizeof(first));
+    rig.chips[1]->writeBuffer(0x1FE, second, sizeof(second));
+
+    uint8_t back[4];
+    rig.chips[0]->readBuffer(0x1FE, back, sizeof(back));
+    rig.chips[0]->endSequentialRead();
+    ASSERT_EQ(std::vector<uint8_t>(back, back + 4),
+              std::vector<uint8_t>(first, first + 4));
+    ASSERT_EQ(rig.chips[1]->readByte(0x000), 7);
+
+    ASSERT_EQ(rig.models[0]->memory()[0x1FF], 2);
+    ASSERT_EQ(rig.models[1]->memory()[0x1FF], 8);
+    ASSERT_EQ(rig.bus.preemptions(), 0u);
+}
+
+TEST(SpiBusTest, SelectTakesBusFromOpenTransaction) {
+    eeprom_bus_rig rig(2, std::chrono::microseconds(0));
+    spi_bus_device &a = rig.bus.device(0);
+    spi_bus_device &b = rig.bus.device(1);
+
+    // erased memory streams out 0xFF until CS rises
+    const uint8_t read[] = { 0x03, 0x00 };
+    a.select();
+    a.send(read, sizeof(read));
+    ASSERT_EQ(a.transfer(0x00), 0xFF);
+    ASSERT_FALSE(rig.wires.read(a.chipSelect()));
+
+    b.select();
+    ASSERT_TRUE(rig.wires.read(a.chipSelect()));
+    ASSERT_FALSE(rig.wires.read(b.chipSelect()));
+    ASSERT_EQ(rig.bus.preemptions(), 1u);
+
+    // the first chip no longer drives MISO under the RDSR
+    b.transfer(0x05);
+    ASSERT_EQ(b.transfer(0x00), 0x00);
+    b.deselect();
+}
+
+TEST(SpiBusTest, PreemptedReadStreamIsReopened) {
+    eeprom_bus_rig rig(2, std::chrono::microseconds(0));
+    rig.models[0]->memory()[0x000] = 0x11;
+    rig.models[0]->memory()[0x001] = 0x22;
+    rig.models[1]->memory()[0x000] = 0x33;
+
+    // plain drivers, nobody closes the streams
+    ASSERT_EQ(rig.chips[0]->readByte(0x000), 0x11);
+    ASSERT_EQ(rig.chips[1]->readByte(0x000), 0x33);
+    ASSERT_EQ(rig.chips[0]->readByte(0x001), 0x22);
+
+    ASSERT_EQ(rig.bus.preemptions(), 2u);
+}
+
+TEST(StripedTest, InterleavesPagesAcrossChips) {
+    eeprom_bus_rig rig(4, std::chrono::microseconds(0));
+    striped_memory_device striped(rig.drivers());
+    ASSERT_EQ(striped.capacity(), 2048u);
+
+    std::vector<uint8_t> data(striped.capacity());
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 13 + i / 256);
+    striped.writeBuffer(0, data.data(), data.size());
+    striped.sync();
+
+    // logical page p lives in chip p % 4 at page p / 4
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        std::size_t page = i / 16;
+        std::size_t chipAddress = page / 4 * 16 + i % 16;
+        ASSERT_EQ(rig.models[page % 4]->memory()[chipAddress], data[i]);
+    }
+
+    // unaligned, wrapping around the end of the striped device
+    std::vector<uint8_t> back(100);
+    striped.readBuffer(2000, back.data(), back.size());
+    for (std::size_t i = 0; i < back.size(); ++i)
+        ASSERT_EQ(back[i], data[(2000 + i) % 2048]);
+
+    striped.writeByte(0x35, 0xA5);
+    ASSERT_EQ(striped.readByte(0x35), 0xA5);
+    ASSERT_EQ(rig.models[3]->memory()[0x05], 0xA5);
+    ASSERT_EQ(rig.bus.preemptions(), 0u);
+}
+
+TEST(StripedTest, RejectsChipCountsOutOfRange) {
+    ASSERT_THROW(striped_memory_device({}), std::invalid_argument);
+
+    eeprom_bus_rig rig(1, std::chrono::microseconds(0));
+    std::vector<eeprom_api *> tooMany(striped_memory_device::MAX_CHIPS + 1,
+                                      rig.chips[0].get());
+    ASSERT_THROW(striped_memory_device{ tooMany }, std::invalid_argument);
+    ASSERT_THROW(striped_memory_device({ rig.chips[0].get(), nullptr }),
+                 std::invalid_argument);
+
+    tooMany.pop_back();
+    striped_memory_device largest(tooMany);
+    ASSERT_EQ(largest.capacity(), 65536u);
+}
+
+TEST(StripedTest, WriteCyclesOverlap) {
+    const auto writeCycle = std::chrono::microseconds(2000);
+    std::vector<uint8_t> data(256, 0x42);
+
+    auto timeWrite = [&](std::size_t chips) {
+        eeprom_bus_rig rig(chips, writeCycle);
+        striped_memory_device striped(rig.drivers());
+        auto start = std::chrono::steady_clock::now();
+        striped.writeBuffer(0, data.data(), data.size());
+        striped.sync();
+        return std::chrono::steady_clock::now() - start;
+    };
+
+    auto one = timeWrite(1);
+    auto four = timeWrite(4);
+
+    // 16 write cycles back to back against 4 rounds of 4
+    ASSERT_GE(one, 16 * writeCycle);
+    ASSERT_LT(four * 2, one);
+}
+
+TEST(EepromChipTest, HeaderEncoding) {
+    uint8_t header[4];
+
+    eeprom_25lc040a::encodeHeader(0x03, 0x1A5, header);
+    ASSERT_EQ(header[0], 0x0B);
+    ASSERT_EQ(header[1], 0xA5);
+
+    eeprom_25lc010a::encodeHeader(0x03, 0x7F, header);
+    ASSERT_EQ(header[0], 0x03);
+    ASSERT_EQ(header[1], 0x7F);
+
+    eeprom_25lc256::encodeHeader(0x02, 0x7FFE, header);
+    ASSERT_EQ(header[0], 0x02);
+    ASSERT_EQ(header[1], 0x7F);
+    ASSERT_EQ(header[2], 0xFE);
+
+    eeprom_25lc1024::encodeHeader(0x03, 0x1ABCD, header);
+    ASSERT_EQ(header[0], 0x03);
+    ASSERT_EQ(header[1], 0x01);
+    ASSERT_EQ(header[2], 0xAB);
+    ASSERT_EQ(header[3], 0xCD);
+
+    static_assert(std::is_same_v<basic_eeprom_api<eeprom_25lc512>::address_type,
+                                 uint16_t>);
+    static_assert(std::is_same_v<
+                  basic_eeprom_api<eeprom_25lc1024>::address_type, uint32_t>);
+    static_assert(basic_eeprom_api<eeprom_25lc1024>::WRITE_CYCLE_TIME ==
+                  std::chrono::microseconds(6000));
+}
+
+template <class Chip> static void chipRoundTrip() {
+    eeprom_model_config config = eeprom_model_config::forChip<Chip>();
+    config.writeCycle = std::chrono::microseconds(0);
+    eeprom_model model(config);
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    basic_eeprom_api<Chip> eeprom(spi);
+
+    // from 2 bytes into the third page from the top, wrapping to 0
+    const std::size_t start = Chip::capacity - 3 * Chip::pageSize + 2;
+    std::vector<uint8_t> data(3 * Chip::pageSize + 5);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 5 + 1);
+
+    eeprom.writeBuffer(start, data.data(), data.size());
+    ASSERT_EQ(model.writeCycles(), 4u);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        ASSERT_EQ(model.memory()[(start + i) % Chip::capacity], data[i]);
+
+    std::vector<uint8_t> back(data.size());
+    eeprom.readBuffer(start, back.data(), back.size());
+    ASSERT_EQ(back, data);
+
+    eeprom.writeBit(Chip::capacity - 1, 0, false);
+    ASSERT_EQ(model.memory()[Chip::capacity - 1],
+              data[Chip::capacity - 1 - start] & 0xFE);
+}
+
+TEST(EepromChipTest, FamilyRoundTrips) {
+    chipRoundTrip<eeprom_25lc010a>();
+    chipRoundTrip<eeprom_25lc040a>();
+    chipRoundTrip<eeprom_25lc080c>();
+    chipRoundTrip<eeprom_25lc256>();
+    chipRoundTrip<eeprom_25lc512>();
+    chipRoundTrip<eeprom_25lc1024>();
+}
+
+struct ram_device : i_memory_device_api {
+    std::vector<uint8_t> memory = std::vector<uint8_t>(512, 0xFF);
+    std::vector<unsigned> pageWrites = std::vector<unsigned>(32, 0);
+    unsigned reads = 0;
+
+    void writeByte(uint16_t address, uint8_t data) override {
+        writeBuffer(address, &data, 1);
+    }
+    uint8_t readByte(uint16_t address) override { return memory[address]; }
+    void writeBuffer(uint16_t address, const uint8_t *data,
+                     std::size_t length) override {
+        ++pageWrites[address / 16];
+        std::copy(data, data + length, memory.begin() + address);
+    }
+    void readBuffer(uint16_t address, uint8_t *buffer,
+                    std::size_t length) override {
+        ++reads;
+        std::copy_n(memory.begin() + address, length, buffer);
+    }
+    void writeBit(uint16_t, uint8_t, bool) override {}
+    bool readBit(uint16_t, uint8_t) override { return false; }
+};
+
+static uint32_t storedCounter(const record_store &store, uint8_t key) {
+    uint32_t value = 0;
+    uint8_t bytes[4] = {};
+    store.read(key, bytes, sizeof(bytes));
+    for (int i = 3; i >= 0; --i)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+static bool putCounter(record_store &store, uint8_t key, uint32_t value) {
+    const uint8_t bytes[4] = { static_cast<uint8_t>(value),
+                               static_cast<uint8_t>(value >> 8),
+                               static_cast<uint8_t>(value >> 16),
+                               static_cast<uint8_t>(value >> 24) };
+    return store.put(key, bytes, sizeof(bytes));
+}
+
+TEST(RecordStoreTest, RemountsFromEepromAndReadsFromRam) {
+    eeprom_model model(instantModel());
+    chip_spi_api spi(model, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    {
+        eeprom_api eeprom(spi);
+        record_store store(eeprom);
+        const uint8_t name[] = { 'b', 'o', 'a', 'r', 'd' };
+        ASSERT_TRUE(store.put(1, name, sizeof(name)));
+        ASSERT_TRUE(putCounter(store, 2, 41));
+        ASSERT_TRUE(putCounter(store, 2, 42));
+        ASSERT_TRUE(putCounter(store, 3, 7));
+        ASSERT_TRUE(store.erase(3));
+        ASSERT_FALSE(store.erase(3));
+        ASSERT_EQ(model.writeCycles(), 5u);
+    }
+
+    eeprom_api eeprom(spi);
+    record_store store(eeprom);
+    uint64_t pinOps = model.pinWrites() + model.pinReads();
+
+    uint8_t name[8] = {};
+    ASSERT_EQ(store.read(1, name, sizeof(name)), 5u);
+    ASSERT_EQ(std::string(name, name + 5), "board");
+    ASSERT_EQ(storedCounter(store, 2), 42u);
+    ASSERT_FALSE(store.contains(3));
+    ASSERT_EQ(store.length(3), 0u);
+    ASSERT_FALSE(store.contains(4));
+    ASSERT_EQ(model.pinWrites() + model.pinReads(), pinOps);
+
+    // the same value again costs no write cycle
+    ASSERT_TRUE(putCounter(store, 2, 42));
+    ASSERT_EQ(store.stats().unchanged, 1u);
+    ASSERT_EQ(model.writeCycles(), 5u);
+}
+
+TEST(RecordStoreTest, UpdatesSpreadWearOverAllPages) {
+    ram_device device;
+    record_store store(device);
+    for (uint8_t key = 10; key < 15; ++key)
+        ASSERT_TRUE(putCounter(store, key, key));
+
+    for (uint32_t i = 0; i < 1000; ++i)
+        ASSERT_TRUE(putCounter(store, 0, i));
+
+    auto [least, most] = std::minmax_element(device.pageWrites.begin(),
+                                             device.pageWrites.end());
+    ASSERT_LE(*most, *least + 1);
+    ASSERT_LT(*most, 50u);
+    ASSERT_GT(store.stats().relocations, 0u);
+
+    record_store remounted(device);
+    ASSERT_EQ(storedCounter(remounted, 0), 999u);
+    for (uint8_t key = 10; key < 15; ++key)
+        ASSERT_EQ(storedCounter(remounted, key), key);
+}
+
+TEST(RecordStoreTest, FullStoreStillTakesUpdates) {
+    ram_device device;
+    record_store store(device);
+    ASSERT_EQ(store.maxRecords(), 30u);
+
+    for (uint8_t key = 0; key < 30; ++key)
+        ASSERT_TRUE(putCounter(store, key, key));
+    ASSERT_FALSE(putCounter(store, 30, 30));
+
+    const uint8_t tooLong[12] = {};
+    ASSERT_FALSE(store.put(0, tooLong, sizeof(tooLong)));
+    ASSERT_FALSE(store.put(record_store::NO_KEY, tooLong, 1));
+
+    std::vector<uint32_t> expected(30);
+    for (uint32_t i = 0; i < 100; ++i) {
+        expected[i % 30] = 1000 + i;
+        ASSERT_TRUE(putCounter(store, i % 30, expected[i % 30]));
+    }
+
+    record_store remounted(device);
+    for (uint8_t key = 0; key < 30; ++key)
+        ASSERT_EQ(storedCounter(remounted, key), expected[key]);
+}
+
+TEST(RecordStoreTest, TornWriteKeepsPreviousVersion) {
+    ram_device device;
+    record_store store(device);
+    ASSERT_TRUE(putCounter(store, 7, 1));
+    ASSERT_TRUE(putCounter(store, 7, 2));
+
+    // the second record is cut short: its value never arrived
+    device.memory[16 + record_store::HEADER_SIZE] ^= 0x5A;
+
+    record_store remounted(device);
+    ASSERT_EQ(storedCounter(remounted, 7), 1u);
+    ASSERT_TRUE(putCounter(remounted, 7, 3));
+    ASSERT_EQ(storedCounter(record_store(device), 7), 3u);
+}
+
+TEST(RecordStoreTest, ErasedKeyStaysErasedAcrossCompaction) {
+    ram_device device;
+    record_store store(device);
+    ASSERT_TRUE(putCounter(store, 3, 33));
+    ASSERT_TRUE(putCounter(store, 3, 34));
+    ASSERT_TRUE(store.erase(3));
+
+    for (uint32_t i = 0; i < 200; ++i) {
+        ASSERT_TRUE(putCounter(store, 1, i));
+        if (i % 7 == 0) {
+            record_store remounted(device);
+            ASSERT_FALSE(remounted.contains(3));
+            ASSERT_EQ(storedCounter(remounted, 1), i);
+        }
+        if (i % 3 == 0)
+            store.compactStep();
+    }
+    ASSERT_FALSE(record_store(device).contains(3));
+}
+
+TEST(CachedMemoryDeviceTest, RejectsUnusableGeometry) {
+    ram_device device;
+    ASSERT_THROW(cached_memory_device(device, 0, 520, 16),
+                 std::invalid_argument);
+    ASSERT_THROW(cached_memory_device(device, 0, 512, 0),
+                 std::invalid_argument);
+    ASSERT_THROW(cached_memory_device(device, 0, 0, 16),
+                 std::invalid_argument);
+    ASSERT_THROW(cached_memory_device(device, 0, 1 << 17, 16),
+                 std::invalid_argument);
+    cached_memory_device(device, 0, 512, 16);
+}
+
+TEST(RecordStoreTest, RejectsUnusableGeometry) {
+    ram_device device;
+    // a 128-byte value would set the tombstone bit of the length byte
+    ASSERT_THROW(record_store(device, 512, 133), std::invalid_argument);
+    ASSERT_THROW(record_store(device, 512, 4), std::invalid_argument);
+    ASSERT_THROW(record_store(device, 512, 0), std::invalid_argument);
+    ASSERT_THROW(record_store(device, 32, 16), std::invalid_argument);
+    ASSERT_THROW(record_store(device, 1 << 17, 128), std::invalid_argument);
+    record_store(device, 48, 16);
+    record_store(device, 396, 132);
+}
+
+TEST(RecordStoreTest, ZeroFilledDeviceIsEmpty) {
+    ram_device device;
+    std::fill(device.memory.begin(), device.memory.end(), 0x00);
+
+    record_store store(device);
+    ASSERT_FALSE(store.contains(0));
+    ASSERT_TRUE(putCounter(store, 0, 42));
+    ASSERT_EQ(storedCounter(record_store(device), 0), 42u);
+}
+
+TEST(AsyncMemoryDeviceTest, NeighbouringReadsShareOneDeviceRead) {
+    ram_device ram;
+    for (std::size_t i = 0; i < ram.memory.size(); ++i)
+        ram.memory[i] = static_cast<uint8_t>(i);
+    async_memory_device device(ram, std::chrono::milliseconds(100));
+
+    // eight threads read neighbouring 4-byte fields at once
+    std::vector<std::array<uint8_t, 4>> fields(8);
+    std::atomic<int> ready{ 0 };
+    std::vector<std::thread> readers;
+    for (std::size_t k = 0; k < fields.size(); ++k) {
+        readers.emplace_back([&, k] {
+            ++ready;
+            while (ready < static_cast<int>(fields.size()))
+                std::this_thread::yield();
+            device.readBuffer(static_cast<uint16_t>(0x40 + 4 * k),
+                              fields[k].data(), fields[k].size());
+        });
+    }
+    for (auto &reader : readers)
+        reader.join();
+
+    for (std::size_t k = 0; k < fields.size(); ++k)
+        for (std::size_t i = 0; i < 4; ++i)
+            ASSERT_EQ(fields[k][i], 0x40 + 4 * k + i);
+    ASSERT_LE(device.deviceReads(), 2u);
+    ASSERT_EQ(device.deviceReads(), ram.reads);
+}
+
+TEST(AsyncMemoryDeviceTest, MergeWindowKeepsReadYourWrites) {
+    ram_device ram;
+    async_memory_device device(ram, std::chrono::milliseconds(20));
+
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    std::future<void> written = device.writeBuffer(0x12, data, sizeof(data));
+
+    uint8_t before[8];
+    device.readBuffer(0x10, before, sizeof(before));
+    ASSERT_EQ(before[1], 0xFF);
+    ASSERT_EQ(before[2], 1);
+    ASSERT_EQ(before[5], 4);
+    ASSERT_EQ(before[6], 0xFF);
+
+    written.wait();
+    device.drain();
+    ASSERT_EQ(device.deviceWrites(), 1u);
+    ASSERT_EQ(ram.memory[0x15], 4);
+}
+
+TEST(GpioTraceTest, RingDropsWhenFull) {
+    gpio_trace_ring ring(3);
+    ASSERT_EQ(ring.capacity(), 4u);
+
+    for (uint64_t i = 0; i < 5; ++i)
+        ASSERT_EQ(ring.push({ i, 1, 0, gpio_trace_kind::write }), i < 4);
+    ASSERT_EQ(ring.dropped(), 1u);
+
+    gpio_trace_event out[2];
+    ASSERT_EQ(ring.pop(out, 2), 2u);
+    ASSERT_EQ(out[0].time, 0u);
+    ASSERT_EQ(out[1].time, 1u);
+
+    // the gap is marked in front of the next event
+    ASSERT_TRUE(ring.push({ 9, 1, 1, gpio_trace_kind::write }));
+    std::vector<gpio_trace_event> rest;
+    ASSERT_EQ(ring.drain(rest), 4u);
+    ASSERT_EQ(rest[2].kind, gpio_trace_kind::gap);
+    ASSERT_EQ(rest[2].levels, 1u);
+    ASSERT_EQ(rest.back().time, 9u);
+}
+
+TEST(GpioTraceTest, DecoderFlagsTransactionsAcrossGaps) {
+    eeprom_model model(instantModel());
+    gpio_trace_ring ring(64);
+    tracing_gpio_driver gpio(model, ring);
+    chip_spi_api spi(gpio, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+
+    // the second transaction overflows the ring
+    const uint8_t rdsr[] = { 0x05, 0x00 };
+    spi.transaction(rdsr, nullptr, sizeof(rdsr));
+    spi.transaction(rdsr, nullptr, sizeof(rdsr));
+    std::vector<gpio_trace_event> events;
+    ring.drain(events);
+    ASSERT_EQ(events.size(), ring.capacity());
+    ASSERT_GT(ring.dropped(), 0u);
+    spi.transaction(rdsr, nullptr, sizeof(rdsr));
+    ring.drain(events);
+
+    std::stringstream file;
+    writeTraceHeader(file);
+    writeTraceEvents(file, events.data(), events.size());
+    std::vector<gpio_trace_event> loaded;
+    ASSERT_TRUE(readTrace(file, loaded));
+    ASSERT_EQ(loaded[64].kind, gpio_trace_kind::gap);
+    ASSERT_EQ(loaded[64].levels, ring.dropped());
+
+    // the second CS rise was lost: the second and third
+    // transactions come out as one, flagged
+    std::vector<spi_trace_transaction> transactions =
+        decodeSpi(loaded, spi_pin_map{ 0, 1, 2, 3 });
+    ASSERT_EQ(transactions.size(), 2u);
+    ASSERT_FALSE(transactions[0].gap);
+    ASSERT_EQ(transactions[0].mosi, (std::vector<uint8_t>{ 0x05, 0x00 }));
+    ASSERT_TRUE(transactions[1].gap);
+
+    std::ostringstream vcd;
+    writeVcd(vcd, loaded, { { 0, "cs" } });
+    ASSERT_NE(vcd.str().find("events dropped $end"), std::string::npos);
+}
+
+TEST(GpioTraceTest, DecodesEepromTrafficFromTrace) {
+    eeprom_model model(instantModel());
+    gpio_trace_ring ring(1 << 16);
+    tracing_gpio_driver gpio(model, ring);
+    chip_spi_api spi(gpio, 0, 1, 2, 3, spi_timing(spi_timing::mode::none));
+    eeprom_api eeprom(spi);
+
+    eeprom.writeByte(0x10, 0xAB);
+    ASSERT_EQ(eeprom.readByte(0x10), 0xAB);
+    eeprom.endSequentialRead();
+
+    std::vector<gpio_trace_event> events;
+    ring.drain(events);
+    ASSERT_EQ(ring.dropped(), 0u);
+
+    // through a trace file and back
+    std::stringstream file;
+    writeTraceHeader(file);
+    writeTraceEvents(file, events.data(), events.size());
+    std::vector<gpio_trace_event> loaded;
+    ASSERT_TRUE(readTrace(file, loaded));
+    ASSERT_EQ(loaded.size(), events.size());
+
+    std::vector<spi_trace_transaction> transactions =
+        decodeSpi(loaded, spi_pin_map{ 0, 1, 2, 3 });
+    auto write = std::find_if(transactions.begin(), transactions.end(),
+                              [](const spi_trace_transaction& t) {
+                                  return !t.mosi.empty() && t.mosi[0] == 0x02;
+                              });
+    auto read = std::find_if(transactions.begin(), transactions.end(),
+                             [](const spi_trace_transaction& t) {
+                                 return !t.mosi.empty() && t.mosi[0] == 0x03;
+                             });
+    ASSERT_NE(write, transactions.end());
+    ASSERT_NE(read, transactions.end());
+    ASSERT_EQ(write->mosi, (std::vector<uint8_t>{ 0x02, 0x10, 0xAB }));
+    ASSERT_EQ(read->miso.size(), 3u);
+    ASSERT_EQ(read->miso[2], 0xAB);
+    ASSERT_EQ(read->trailingBits, 0u);
+    ASSERT_LE(read->start, read->end);
+
+    std::ostringstream vcd;
+    writeVcd(vcd, loaded, { { 0, "cs" }, { 1, "sck" } });
+    ASSERT_NE(vcd.str().find("$var wire 1 ! cs $end"), std::string::npos);
+    ASSERT_NE(vcd.str().find("\n0!\n"), std::string::npos);
+}
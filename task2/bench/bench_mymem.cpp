@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <vector>
+#include "mymem.h"
+
+/**
+ * @brief my_free with arg 0 blocks of arg 1 bytes outstanding.
+ *
+ * Each iteration frees a block picked across the whole heap and
+ * allocates it again, so the heap keeps its size; allocation pops
+ * the free list, the cost that grows with the heap is the free.
+ */
+static void BM_FreeWithOutstandingBlocks(benchmark::State &state) {
+  const std::size_t count = state.range(0);
+  const std::size_t size = state.range(1);
+
+  std::vector<void *> live(count);
+  for (void *&block : live)
+    block = my_malloc(size);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    i = (i + 7919) % count;
+    my_free(live[i]);
+    live[i] = my_malloc(size);
+    benchmark::DoNotOptimize(live[i]);
+  }
+
+  for (void *block : live)
+    my_free(block);
+}
+BENCHMARK(BM_FreeWithOutstandingBlocks)
+    ->ArgNames({"blocks", "size"})
+    ->ArgsProduct({{64, 1024, 16384}, {15, 180}});
@@ -9,14 +9,6 @@
 #define TRUE 1
 #define FALSE 0
 
-#ifndef ALLOCATOR_15_BLOCK_PER_BUFFER
-  #define ALLOCATOR_15_BLOCK_PER_BUFFER 4
-#endif
-
-#ifndef ALLOCATOR_180_BLOCK_PER_BUFFER
-  #define ALLOCATOR_180_BLOCK_PER_BUFFER 1
-#endif
-
 #if !defined(NAIVE_BOOTSTRAP) && !defined(POSIX_BOOTSTRAP)
 #if defined(__unix__) || defined(__APPLE__)
 #define POSIX_BOOTSTRAP
@@ -34,15 +26,62 @@
     "Seems like you have to provide a boostrap-family functions implementation by yourself"
 #endif
 
+// granularity of the ownership lookup, buffers start on a page boundary
+#ifndef ALLOCATOR_PAGE_SIZE
+  #ifdef POSIX_BOOTSTRAP
+    #define ALLOCATOR_PAGE_SIZE 4096
+  #else
+    #define ALLOCATOR_PAGE_SIZE 256
+  #endif
+#endif
+
+#if (ALLOCATOR_PAGE_SIZE & (ALLOCATOR_PAGE_SIZE - 1)) != 0
+#error "ALLOCATOR_PAGE_SIZE must be a power of two"
+#endif
+
+#ifndef ALLOCATOR_PAGE_TABLE_INITIAL_SIZE
+  #define ALLOCATOR_PAGE_TABLE_INITIAL_SIZE 64
+#endif
+
+// buffers start at this many pages and double up to the cap
+#ifndef ALLOCATOR_BUFFER_INITIAL_PAGES
+  #define ALLOCATOR_BUFFER_INITIAL_PAGES 1
+#endif
+
+#ifndef ALLOCATOR_BUFFER_MAX_PAGES
+  #ifdef POSIX_BOOTSTRAP
+    #define ALLOCATOR_BUFFER_MAX_PAGES 64
+  #else
+    #define ALLOCATOR_BUFFER_MAX_PAGES 16
+  #endif
+#endif
+
+#if ALLOCATOR_BUFFER_INITIAL_PAGES < 1 || \
+    ALLOCATOR_BUFFER_MAX_PAGES < ALLOCATOR_BUFFER_INITIAL_PAGES
+#error "Need 1 <= ALLOCATOR_BUFFER_INITIAL_PAGES <= ALLOCATOR_BUFFER_MAX_PAGES"
+#endif
+
 #define ALIGN_TO(value, alignment) \
   (((value) + ((alignment) - 1)) & ~((alignment) - 1))
 
+#define PAGE_OF(ptr) ((uintptr_t) (ptr) / ALLOCATOR_PAGE_SIZE)
+
+struct allocator;
+
+// lives at the start of its own pages, blocks follow it,
+// [buffer, buffer_bump) are blocks already handed out at least once
 typedef struct allocator_buffer {
   struct allocator_buffer *next;
+  struct allocator *allocator;
+  size_t allocator_buffer_size;
   uint8_t *buffer_end;
+  uint8_t *buffer_bump;
   uint8_t *buffer;
 } allocator_buffer_t;
 
+#define ALLOCATOR_BUFFER_HEADER_SIZE \
+  ALIGN_TO(sizeof(allocator_buffer_t), alignof(max_align_t))
+
 typedef struct allocator_block {
   struct allocator_block *next;
 } allocator_block_t;
@@ -50,12 +89,23 @@ typedef struct allocator_block {
 typedef struct allocator {
   size_t allocator_buffer_size;
   size_t allocator_block_size;
-  size_t allocator_blocks_per_buffer;
 
   allocator_buffer_t *buffers;
   allocator_block_t *blocks;
 } allocator_t;
 
+// one entry per page covered by a buffer, open addressing
+typedef struct allocator_page {
+  uintptr_t page;
+  allocator_buffer_t *allocator_buffer;
+} allocator_page_t;
+
+typedef struct allocator_page_table {
+  allocator_page_t *pages;
+  size_t capacity;
+  size_t count;
+} allocator_page_table_t;
+
 /**
  * \internal
  * @brief Allocates raw memory for the allocator backend.
@@ -82,25 +132,79 @@ static void *bootstrap_allocator(size_t size);
  */
 static void bootstrap_free(void *ptr, size_t size);
 
+/**
+ * \internal
+ * @brief Allocates raw memory starting on an ALLOCATOR_PAGE_SIZE boundary.
+ *
+ * Buffers are aligned so that no page holds blocks of two buffers, which is
+ * what lets the page table resolve a pointer to its buffer.
+ *
+ * @param size The number of bytes to allocate.
+ * @return Page aligned pointer to allocated memory, or NULL on failure.
+ */
+static void *bootstrap_allocator_pages(size_t size);
+
+/**
+ * \internal
+ * @brief Frees memory previously allocated by bootstrap_allocator_pages.
+ *
+ * @param ptr Pointer to memory to free.
+ * @param size Size of the memory block.
+ */
+static void bootstrap_free_pages(void *ptr, size_t size);
+
+/**
+ * \internal
+ * @brief Finds the buffer owning a pointer.
+ *
+ * Looks the page of the pointer up in the page table, so the cost does not
+ * depend on the number of buffers. The pointer itself is never dereferenced.
+ *
+ * @param ptr Pointer to look up.
+ * @return Buffer whose pages contain the pointer, or NULL if none does.
+ */
+static allocator_buffer_t *page_table_find(const void *ptr);
+
+/**
+ * \internal
+ * @brief Registers every page of a buffer in the page table.
+ *
+ * The table doubles whenever it would get more than half full.
+ *
+ * @param allocator_buffer Buffer to register.
+ * @return TRUE on success, FALSE on allocation failure.
+ */
+static int page_table_insert(allocator_buffer_t *allocator_buffer);
+
+/**
+ * \internal
+ * @brief Removes every page of a buffer from the page table.
+ *
+ * @param allocator_buffer Buffer to unregister.
+ */
+static void page_table_remove(allocator_buffer_t *allocator_buffer);
+
 /**
  * \internal
  * @brief Initializes an allocator structure.
  *
- * Sets up sizes and counters for blocks and buffers, but does not allocate
- * memory yet.
+ * Sets up the block size and the size of the first buffer, but does not
+ * allocate memory yet.
  *
  * @param allocator_block_size Size of each block in bytes.
- * @param blocks_per_buffer Number of blocks per buffer.
  * @return Initialized allocator_t structure.
  */
-static allocator_t allocator_init(size_t allocator_block_size,
-                                  size_t blocks_per_buffer);
+static allocator_t allocator_init(size_t allocator_block_size);
 
 /**
  * \internal
  * @brief Allocates a new buffer and splits it into blocks for the allocator.
  *
- * Adds all blocks from the new buffer to the free list of the allocator.
+ * The buffer takes whole pages with its header in the first bytes, so one
+ * bootstrap call feeds every block it holds. Each buffer is twice the size of
+ * the previous one, up to ALLOCATOR_BUFFER_MAX_PAGES. Only the header is
+ * written, blocks are carved later by allocator_alloc, so untouched pages stay
+ * unfaulted. Registers the buffer in the page table.
  *
  * @param allocator Pointer to allocator structure.
  * @return TRUE on success, FALSE on allocation failure.
@@ -111,7 +215,9 @@ static int allocator_alloc_buffer(allocator_t *allocator);
  * \internal
  * @brief Allocates a block of memory from the allocator.
  *
- * If no free blocks exist, a new buffer is allocated automatically.
+ * Recycled blocks from the free list go first. Otherwise the next block is
+ * carved from the newest buffer in ascending address order, and once that
+ * buffer is used up a new one is allocated automatically.
  *
  * @param allocator Pointer to allocator structure.
  * @param size Requested block size in bytes (must be <= allocator_block_size).
@@ -121,16 +227,17 @@ static allocator_block_t *allocator_alloc(allocator_t *allocator, size_t size);
 
 /**
  * \internal
- * @brief Returns a block to the allocator's free list.
+ * @brief Returns a block to the free list of the allocator owning a buffer.
  *
- * Checks that the block belongs to this allocator before freeing.
+ * Checks that the pointer is the start of a block of the buffer that has been
+ * carved already before freeing.
  *
- * @param allocator Pointer to allocator structure.
+ * @param allocator_buffer Buffer found by page_table_find, may be NULL.
  * @param allocator_block Block to free.
- * @return TRUE if the block belongs to this allocator and was freed, FALSE
+ * @return TRUE if the block belongs to the buffer and was freed, FALSE
  * otherwise.
  */
-static int allocator_free(allocator_t *allocator,
+static int allocator_free(allocator_buffer_t *allocator_buffer,
                           allocator_block_t *allocator_block);
 
 /**
@@ -170,7 +277,8 @@ void *my_malloc(size_t size);
 /**
  * @brief Frees memory previously allocated by my_malloc.
  *
- * Checks both global allocators. Aborts if pointer does not belong to either
+ * Resolves the owning buffer, and with it the block size, through the page
+ * table in constant time. Aborts if pointer does not belong to either
  * allocator.
  *
  * @param ptr Pointer to memory to free. If NULL, does nothing.
@@ -210,47 +318,223 @@ static void bootstrap_free(void *ptr, size_t size)
 #endif
 }
 
-static allocator_t allocator_init(size_t allocator_block_size,
-                                  size_t blocks_per_buffer)
+static void *bootstrap_allocator_pages(size_t size)
+{
+#ifdef NAIVE_BOOTSTRAP
+  // room to align and to remember what malloc returned
+  uint8_t *raw = malloc(size + ALLOCATOR_PAGE_SIZE - 1 + sizeof(void *));
+  if (!raw)
+    return NULL;
+
+  uintptr_t aligned =
+      ALIGN_TO((uintptr_t) raw + sizeof(void *), ALLOCATOR_PAGE_SIZE);
+  ((void **) aligned)[-1] = raw;
+
+  return (void *) aligned;
+#endif
+
+#ifdef POSIX_BOOTSTRAP
+  uint8_t *ptr = bootstrap_allocator(size);
+  if (!ptr || (uintptr_t) ptr % ALLOCATOR_PAGE_SIZE == 0)
+    return ptr;
+
+  // system pages are smaller than ours, map more and trim
+  bootstrap_free(ptr, size);
+
+  size_t mapped = size + ALLOCATOR_PAGE_SIZE;
+  uint8_t *raw = bootstrap_allocator(mapped);
+  if (!raw)
+    return NULL;
+
+  ptr = (uint8_t *) ALIGN_TO((uintptr_t) raw, ALLOCATOR_PAGE_SIZE);
+  if (ptr != raw)
+    munmap(raw, ptr - raw);
+  munmap(ptr + size, raw + mapped - (ptr + size));
+
+  return ptr;
+#endif
+}
+
+static void bootstrap_free_pages(void *ptr, size_t size)
+{
+#ifdef NAIVE_BOOTSTRAP
+  (void) size;
+  free(((void **) ptr)[-1]);
+#endif
+
+#ifdef POSIX_BOOTSTRAP
+  bootstrap_free(ptr, size);
+#endif
+}
+
+allocator_page_table_t allocator_pages;
+
+static size_t page_table_slot(uintptr_t page, size_t capacity)
+{
+  // odd multiplier: consecutive pages land in distinct slots
+  return ((size_t) page * (size_t) 0x9E3779B1u) & (capacity - 1);
+}
+
+static allocator_buffer_t *page_table_find(const void *ptr)
+{
+  if (!allocator_pages.capacity)
+    return NULL;
+
+  uintptr_t page = PAGE_OF(ptr);
+  size_t mask = allocator_pages.capacity - 1;
+
+  for (size_t slot = page_table_slot(page, allocator_pages.capacity);;
+       slot = (slot + 1) & mask) {
+    allocator_page_t *entry = &allocator_pages.pages[slot];
+    if (!entry->allocator_buffer)
+      return NULL;
+    if (entry->page == page)
+      return entry->allocator_buffer;
+  }
+}
+
+static void page_table_put(allocator_page_t *pages, size_t capacity,
+                           uintptr_t page, allocator_buffer_t *allocator_buffer)
+{
+  size_t slot = page_table_slot(page, capacity);
+  while (pages[slot].allocator_buffer)
+    slot = (slot + 1) & (capacity - 1);
+
+  pages[slot].page = page;
+  pages[slot].allocator_buffer = allocator_buffer;
+}
+
+static int page_table_reserve(size_t count)
+{
+  size_t capacity = allocator_pages.capacity
+                        ? allocator_pages.capacity
+                        : ALLOCATOR_PAGE_TABLE_INITIAL_SIZE;
+  // keep the load at most one half, probes stay short
+  while (capacity < 2 * count)
+    capacity *= 2;
+
+  if (capacity == allocator_pages.capacity)
+    return TRUE;
+
+  allocator_page_t *pages =
+      bootstrap_allocator(capacity * sizeof(allocator_page_t));
+  if (!pages)
+    return FALSE;
+
+  for (size_t i = 0; i != capacity; ++i)
+    pages[i] = (allocator_page_t) { 0 };
+
+  for (size_t i = 0; i != allocator_pages.capacity; ++i) {
+    allocator_page_t *entry = &allocator_pages.pages[i];
+    if (entry->allocator_buffer)
+      page_table_put(pages, capacity, entry->page, entry->allocator_buffer);
+  }
+
+  if (allocator_pages.pages)
+    bootstrap_free(allocator_pages.pages,
+                   allocator_pages.capacity * sizeof(allocator_page_t));
+
+  allocator_pages.pages = pages;
+  allocator_pages.capacity = capacity;
+
+  return TRUE;
+}
+
+static int page_table_insert(allocator_buffer_t *allocator_buffer)
+{
+  uintptr_t first = PAGE_OF(allocator_buffer->buffer);
+  uintptr_t last = PAGE_OF(allocator_buffer->buffer_end - 1);
+
+  if (!page_table_reserve(allocator_pages.count + (last - first + 1)))
+    return FALSE;
+
+  for (uintptr_t page = first; page <= last; ++page)
+    page_table_put(allocator_pages.pages, allocator_pages.capacity, page,
+                   allocator_buffer);
+  allocator_pages.count += last - first + 1;
+
+  return TRUE;
+}
+
+static void page_table_remove(allocator_buffer_t *allocator_buffer)
+{
+  uintptr_t first = PAGE_OF(allocator_buffer->buffer);
+  uintptr_t last = PAGE_OF(allocator_buffer->buffer_end - 1);
+  size_t mask = allocator_pages.capacity - 1;
+
+  for (uintptr_t page = first; page <= last; ++page) {
+    size_t hole = page_table_slot(page, allocator_pages.capacity);
+    while (allocator_pages.pages[hole].allocator_buffer != allocator_buffer ||
+           allocator_pages.pages[hole].page != page)
+      hole = (hole + 1) & mask;
+
+    // backward shift deletion keeps every probe chain unbroken
+    for (size_t next = (hole + 1) & mask;
+         allocator_pages.pages[next].allocator_buffer;
+         next = (next + 1) & mask) {
+      size_t home = page_table_slot(allocator_pages.pages[next].page,
+                                    allocator_pages.capacity);
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        allocator_pages.pages[hole] = allocator_pages.pages[next];
+        hole = next;
+      }
+    }
+
+    allocator_pages.pages[hole] = (allocator_page_t) { 0 };
+    --allocator_pages.count;
+  }
+}
+
+static allocator_t allocator_init(size_t allocator_block_size)
 {
   if (allocator_block_size < sizeof(allocator_block_t))
     allocator_block_size = sizeof(allocator_block_t);
 
   allocator_block_size = ALIGN_TO(allocator_block_size, alignof(max_align_t));
 
+  // the first buffer holds at least one block
+  size_t allocator_buffer_size =
+      (size_t) ALLOCATOR_BUFFER_INITIAL_PAGES * ALLOCATOR_PAGE_SIZE;
+  while (allocator_buffer_size <
+         ALLOCATOR_BUFFER_HEADER_SIZE + allocator_block_size)
+    allocator_buffer_size *= 2;
+
   return (allocator_t) { .allocator_block_size = allocator_block_size,
-                         .allocator_buffer_size =
-                             allocator_block_size * blocks_per_buffer,
-                         .allocator_blocks_per_buffer = blocks_per_buffer };
+                         .allocator_buffer_size = allocator_buffer_size };
 }
 
 static int allocator_alloc_buffer(allocator_t *allocator)
 {
-  uint8_t *buffer = bootstrap_allocator(allocator->allocator_buffer_size);
-  if (!buffer)
-    return FALSE;
+  size_t allocator_buffer_size = allocator->allocator_buffer_size;
 
   allocator_buffer_t *allocator_buffer =
-      bootstrap_allocator(sizeof(allocator_buffer_t));
-  if (!allocator_buffer) {
-    free(buffer);
+      bootstrap_allocator_pages(allocator_buffer_size);
+  if (!allocator_buffer)
+    return FALSE;
+
+  size_t blocks_count =
+      (allocator_buffer_size - ALLOCATOR_BUFFER_HEADER_SIZE) /
+      allocator->allocator_block_size;
+
+  allocator_buffer->allocator = allocator;
+  allocator_buffer->allocator_buffer_size = allocator_buffer_size;
+  allocator_buffer->buffer =
+      (uint8_t *) allocator_buffer + ALLOCATOR_BUFFER_HEADER_SIZE;
+  allocator_buffer->buffer_end =
+      allocator_buffer->buffer + blocks_count * allocator->allocator_block_size;
+  allocator_buffer->buffer_bump = allocator_buffer->buffer;
+
+  if (!page_table_insert(allocator_buffer)) {
+    bootstrap_free_pages(allocator_buffer, allocator_buffer_size);
     return FALSE;
   }
 
-  allocator_buffer->buffer = buffer;
-  allocator_buffer->buffer_end = buffer + allocator->allocator_buffer_size;
   allocator_buffer->next = allocator->buffers;
-
   allocator->buffers = allocator_buffer;
 
-  for (int i = 0; i != allocator->allocator_blocks_per_buffer; ++i) {
-    allocator_block_t *allocator_block =
-        (allocator_block_t *) (allocator_buffer->buffer +
-                               i * allocator->allocator_block_size);
-
-    allocator_block->next = allocator->blocks;
-    allocator->blocks = allocator_block;
-  }
+  if (allocator_buffer_size <
+      (size_t) ALLOCATOR_BUFFER_MAX_PAGES * ALLOCATOR_PAGE_SIZE)
+    allocator->allocator_buffer_size = allocator_buffer_size * 2;
 
   return TRUE;
 }
@@ -260,71 +544,66 @@ static allocator_block_t *allocator_alloc(allocator_t *allocator, size_t size)
   if (size > allocator->allocator_block_size)
     return NULL;
 
-  if (!allocator->blocks) {
+  if (allocator->blocks) {
+    allocator_block_t *allocator_block = allocator->blocks;
+    allocator->blocks = allocator->blocks->next;
+
+    return allocator_block;
+  }
+
+  // older buffers are carved out completely, only the newest has room
+  allocator_buffer_t *allocator_buffer = allocator->buffers;
+  if (!allocator_buffer ||
+      allocator_buffer->buffer_bump == allocator_buffer->buffer_end) {
     int is_allocated_succssfully = allocator_alloc_buffer(allocator);
     if (!is_allocated_succssfully)
       return NULL;
+
+    allocator_buffer = allocator->buffers;
   }
 
-  allocator_block_t *allocator_block = allocator->blocks;
-  allocator->blocks = allocator->blocks->next;
+  allocator_block_t *allocator_block =
+      (allocator_block_t *) allocator_buffer->buffer_bump;
+  allocator_buffer->buffer_bump += allocator->allocator_block_size;
 
   return allocator_block;
 }
 
-static int allocator_free(allocator_t *allocator,
+static int allocator_free(allocator_buffer_t *allocator_buffer,
                           allocator_block_t *allocator_block)
 {
-  int is_block_belongs_to_allocator = FALSE;
-
-  if (!allocator_block) {
-    return is_block_belongs_to_allocator;
-  }
-
-#ifdef ALLOCATOR_DOUBLE_FREE_AWARE
-  int is_already_freed = FALSE;
-  for (allocator_block_t *all_block = allocator->blocks; all_block;
-       all_block = all_block->next) {
-    if (all_block == allocator_block) {
-      is_already_freed = TRUE;
-      break;
-    }
-  }
+  if (!allocator_buffer || !allocator_block)
+    return FALSE;
 
-  if (is_already_freed) {
-    abort();
-  }
-#endif
+  allocator_t *allocator = allocator_buffer->allocator;
 
-  // better to say it's just UB
-  // but design choice with several allocators
-  // force to have such a procedure to
-  // determinate correct free call
+  // the first page holds the header, the pages past the bump
+  // pointer hold blocks never handed out, and the pointer has
+  // to be the start of a block
   uintptr_t allocator_block_ptr = (uintptr_t) allocator_block;
+  uintptr_t buffer_begin_ptr = (uintptr_t) allocator_buffer->buffer;
+  uintptr_t buffer_end_ptr = (uintptr_t) allocator_buffer->buffer_bump;
 
-  for (allocator_buffer_t *allocator_buffer = allocator->buffers;
-       allocator_buffer; allocator_buffer = allocator_buffer->next) {
-    uintptr_t buffer_begin_ptr = (uintptr_t) allocator_buffer->buffer;
-    uintptr_t buffer_end_ptr = (uintptr_t) allocator_buffer->buffer_end;
+  if (allocator_block_ptr < buffer_begin_ptr ||
+      allocator_block_ptr >= buffer_end_ptr)
+    return FALSE;
 
-    if (allocator_block_ptr >= buffer_begin_ptr &&
-        allocator_block_ptr < buffer_end_ptr) {
-      size_t offset = allocator_block_ptr - buffer_begin_ptr;
-      if (offset % allocator->allocator_block_size == 0) {
-        is_block_belongs_to_allocator = TRUE;
-      }
-      break;
-    }
-  }
+  size_t offset = allocator_block_ptr - buffer_begin_ptr;
+  if (offset % allocator->allocator_block_size != 0)
+    return FALSE;
 
-  if (!is_block_belongs_to_allocator) {
-    return is_block_belongs_to_allocator;
+#ifdef ALLOCATOR_DOUBLE_FREE_AWARE
+  for (allocator_block_t *all_block = allocator->blocks; all_block;
+       all_block = all_block->next) {
+    if (all_block == allocator_block)
+      abort();
   }
+#endif
 
   allocator_block->next = allocator->blocks;
   allocator->blocks = allocator_block;
 
-  return is_block_belongs_to_allocator;
+  return TRUE;
 }
 
 static void allocator_self_free(allocator_t *allocator)
@@ -333,8 +612,9 @@ static void allocator_self_free(allocator_t *allocator)
   while (allocator_buffer) {
     allocator_buffer_t *next_allocator_buffer = allocator_buffer->next;
 
-    bootstrap_free(allocator_buffer->buffer, allocator->allocator_buffer_size);
-    bootstrap_free(allocator_buffer, sizeof(allocator_buffer_t));
+    page_table_remove(allocator_buffer);
+    bootstrap_free_pages(allocator_buffer,
+                         allocator_buffer->allocator_buffer_size);
 
     allocator_buffer = next_allocator_buffer;
   }
@@ -352,8 +632,8 @@ static int my_malloc_prep_allocators()
   if (is_allocators_initialized)
     return is_allocators_initialized;
 
-  allocator_15 = allocator_init(15, ALLOCATOR_15_BLOCK_PER_BUFFER);
-  allocator_180 = allocator_init(180, ALLOCATOR_180_BLOCK_PER_BUFFER);
+  allocator_15 = allocator_init(15);
+  allocator_180 = allocator_init(180);
   is_allocators_initialized = TRUE;
 
   return is_allocators_initialized;
@@ -383,7 +663,7 @@ void my_free(void *ptr)
   if (!ptr)
     return;
 
-  if (!allocator_free(&allocator_15, ptr) &&
-      !allocator_free(&allocator_180, ptr))
+  // one lookup resolves both ownership and the size class
+  if (!allocator_free(page_table_find(ptr), ptr))
     abort();
 }
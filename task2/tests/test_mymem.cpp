@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <set>
+#include <vector>
 #include "mymem.h"
 
 TEST(MyMallocTest, BasicAllocation) {
@@ -74,6 +76,87 @@ TEST(MyAllocator, StressTest) {
     }
 }
 
+TEST(MyAllocator, FreeResolvesSizeClass) {
+    const int n = 500;
+    void* small[n];
+    void* large[n];
+
+    for (int i = 0; i < n; ++i) {
+        small[i] = my_malloc(15);
+        large[i] = my_malloc(180);
+        ASSERT_NE(small[i], nullptr);
+        ASSERT_NE(large[i], nullptr);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        my_free(small[i]);
+        my_free(large[i]);
+    }
+
+    // each block went back to the pool of its own size
+    void* a = my_malloc(15);
+    void* b = my_malloc(180);
+    ASSERT_EQ(a, small[n - 1]);
+    ASSERT_EQ(b, large[n - 1]);
+
+    my_free(a);
+    my_free(b);
+}
+
+TEST(MyAllocator, BuffersPackBlocksIntoPages) {
+    const int n = 1000;
+    const uintptr_t page = 256;
+    void* blocks[n];
+    std::set<uintptr_t> pages;
+
+    for (int i = 0; i < n; ++i) {
+        blocks[i] = my_malloc(180);
+        ASSERT_NE(blocks[i], nullptr);
+        pages.insert(reinterpret_cast<uintptr_t>(blocks[i]) / page);
+    }
+
+    // 1000 blocks of 192 bytes need about 750 of the smallest pages,
+    // a buffer per block would touch at least one page per block
+    EXPECT_LT(pages.size(), 900u);
+
+    for (int i = 0; i < n; ++i) {
+        my_free(blocks[i]);
+    }
+}
+
+TEST(MyAllocator, FreshBlocksAscend) {
+    // more than earlier tests ever held, the tail comes from new buffers
+    const int n = 5000;
+    const int tail = 100;
+    std::vector<void*> blocks(n);
+
+    for (int i = 0; i < n; ++i) {
+        blocks[i] = my_malloc(15);
+        ASSERT_NE(blocks[i], nullptr);
+    }
+
+    // carved in address order, at most one jump to the next buffer
+    int descending = 0;
+    for (int i = n - tail; i < n - 1; ++i) {
+        if (blocks[i + 1] < blocks[i])
+            ++descending;
+    }
+    EXPECT_LE(descending, 1);
+
+    for (int i = 0; i < n; ++i) {
+        my_free(blocks[i]);
+    }
+}
+
+TEST(MyAllocator, ForeignPointerAborts) {
+    int local = 0;
+    EXPECT_DEATH(my_free(&local), "");
+
+    char* a = static_cast<char*>(my_malloc(180));
+    EXPECT_DEATH(my_free(a + 1), "");
+    my_free(a);
+}
+
 #ifdef ALLOCATOR_DOUBLE_FREE_AWARE
 TEST(MyAllocator, InvalidFree) {
     void* a = my_malloc(15);